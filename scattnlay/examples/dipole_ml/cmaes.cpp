@@ -0,0 +1,413 @@
+///
+/// @file   cmaes.cpp
+/// @brief  CMA-ES with sep-CMA, IPOP/BIPOP restarts and pwqb bounds.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./cmaes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+namespace jade {
+  namespace {
+    /// @brief Genotype box of every bounded coordinate.
+    const double kGenoScale = 10.;
+    const char kBudgetSpent[] = "budget";
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief Piecewise linear-quadratic transformation of cma.py
+    /// (BoxConstraintsLinQuadTransformation) and lcmaes (pwqBoundStrategy)
+    /// into [lb, ub]: identity in the middle, quadratic near the bounds
+    /// and periodic outside.
+    double LinQuad(double x, double lb, double ub) {
+      const double al = std::min((ub - lb)/2., (1. + std::abs(lb))/20.);
+      const double au = std::min((ub - lb)/2., (1. + std::abs(ub))/20.);
+      if (x < lb - 2.*al - (ub - lb)/2. || x > ub + 2.*au + (ub - lb)/2.) {
+        const double r = 2.*(ub - lb + al + au);  // period
+        const double s = lb - 2.*al - (ub - lb)/2.;
+        x -= r*std::floor((x - s)/r);
+      }
+      if (x > ub + au) x -= 2.*(x - ub - au);
+      if (x < lb - al) x += 2.*(lb - al - x);
+      if (x < lb + al) return lb + (x - (lb - al))*(x - (lb - al))/4./al;
+      if (x < ub - au) return x;
+      if (x < ub + au) return ub - (x - (ub + au))*(x - (ub + au))/4./au;
+      return x;
+    }  // end of double LinQuad()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief Eigen decomposition of the symmetric matrix A (n x n, row
+    /// by row) by cyclic Jacobi rotations, eigenvectors go to the
+    /// columns of V.
+    void SymmetricEigen(long n, std::vector<double> A,                 // NOLINT
+                        std::vector<double> *V, std::vector<double> *values) {
+      V->assign(n*n, 0.);
+      for (long i = 0; i < n; ++i) (*V)[i*n + i] = 1.;                 // NOLINT
+      for (int sweep = 0; sweep < 100; ++sweep) {
+        double off = 0., total = 0.;
+        for (long p = 0; p < n; ++p)                                   // NOLINT
+          for (long q = 0; q < n; ++q) {                               // NOLINT
+            total += A[p*n + q]*A[p*n + q];
+            if (p != q) off += A[p*n + q]*A[p*n + q];
+          }
+        if (off <= 1e-30*total) break;
+        for (long p = 0; p < n; ++p)                                   // NOLINT
+          for (long q = p + 1; q < n; ++q) {                           // NOLINT
+            const double apq = A[p*n + q];
+            if (apq == 0.) continue;
+            const double theta = (A[q*n + q] - A[p*n + p])/(2.*apq);
+            const double t = (theta < 0. ? -1. : 1.)
+              /(std::abs(theta) + std::sqrt(theta*theta + 1.));
+            const double c = 1./std::sqrt(t*t + 1.), s = t*c;
+            for (long k = 0; k < n; ++k) {                             // NOLINT
+              const double akp = A[k*n + p], akq = A[k*n + q];
+              A[k*n + p] = c*akp - s*akq;
+              A[k*n + q] = s*akp + c*akq;
+            }
+            for (long k = 0; k < n; ++k) {                             // NOLINT
+              const double apk = A[p*n + k], aqk = A[q*n + k];
+              A[p*n + k] = c*apk - s*aqk;
+              A[q*n + k] = s*apk + c*aqk;
+            }
+            for (long k = 0; k < n; ++k) {                             // NOLINT
+              const double vkp = (*V)[k*n + p], vkq = (*V)[k*n + q];
+              (*V)[k*n + p] = c*vkp - s*vkq;
+              (*V)[k*n + q] = s*vkp + c*vkq;
+            }
+          }  // end of for each pair
+      }  // end of sweeps
+      values->resize(n);
+      for (long i = 0; i < n; ++i) (*values)[i] = A[i*n + i];          // NOLINT
+    }  // end of void SymmetricEigen()
+  }  // end of namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::SetPopulation(long lambda) {                              // NOLINT
+    if (lambda != 0 && lambda < 2)
+      throw std::invalid_argument("Population should be >= 2 (0 - default)!");
+    lambda_default_ = lambda;
+    return kDone;
+  }  // end of int CMAES::SetPopulation(long lambda)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::SetSigma(double sigma) {
+    if (!(sigma > 0)) throw std::invalid_argument("Sigma should be > 0!");
+    sigma0_ = sigma;
+    return kDone;
+  }  // end of int CMAES::SetSigma(double sigma)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::SetRestarts(Restarts restarts, long max_restarts) {       // NOLINT
+    if (max_restarts < 0)
+      throw std::invalid_argument("Number of restarts should be >= 0!");
+    restarts_kind_ = restarts;
+    max_restarts_ = max_restarts;
+    return kDone;
+  }  // end of int CMAES::SetRestarts()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::SetTolerances(double tol_fun, double tol_x) {
+    if (tol_fun < 0 || tol_x < 0)
+      throw std::invalid_argument("Tolerances should be >= 0!");
+    tol_fun_ = tol_fun;
+    tol_x_ = tol_x;
+    return kDone;
+  }  // end of int CMAES::SetTolerances(double tol_fun, double tol_x)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::RunOptimization() {
+    StartRun();
+    restarts_ = 0;
+    const long lambda_default = lambda_default_ > 0 ? lambda_default_  // NOLINT
+      : 4 + static_cast<long>(3.*std::log(static_cast<double>(dimension_)));  // NOLINT
+    long large_runs = 0, large_evaluations = 0, small_evaluations = 0;  // NOLINT
+    Descent(lambda_default, sigma0_);
+    large_evaluations = evaluations_;
+    while (restarts_kind_ != kNoRestarts && restarts_ < max_restarts_
+           && stop_reason_ != kBudgetSpent) {
+      ++restarts_;
+      const long start = evaluations_;                                 // NOLINT
+      const long lambda_large = lambda_default << (large_runs + 1);    // NOLINT
+      if (restarts_kind_ == kIPOP || small_evaluations >= large_evaluations) {
+        ++large_runs;
+        Descent(lambda_large, sigma0_);
+        large_evaluations += evaluations_ - start;
+      } else {
+        // Small population with a random size and step.
+        const double u = stream_.Uniform();
+        const long lambda = static_cast<long>(                        // NOLINT
+            lambda_default*std::pow(0.5*lambda_large/lambda_default, u*u));
+        Descent(std::max(lambda, 2L), sigma0_*std::pow(10., -2.*u));
+        small_evaluations += evaluations_ - start;
+      }
+    }  // end of restarts
+    if (is_verbose_) {
+      double best_fitness = 0;
+      GetBest(&best_fitness);
+      printf("CMA-ES: best %g after %li evaluations, %li restarts\n",
+             best_fitness, evaluations_, restarts_);
+    }
+    return kDone;
+  }  // end of int CMAES::RunOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CMAES::SetLearningRates() {
+    const double n = dimension_;
+    mu_ = lambda_/2;
+    weights_.resize(mu_);
+    for (long i = 0; i < mu_; ++i)                                     // NOLINT
+      weights_[i] = std::log((lambda_ + 1.)/2.) - std::log(i + 1.);
+    const double sum = std::accumulate(weights_.begin(), weights_.end(), 0.);
+    double sum2 = 0;
+    for (auto &w : weights_) {
+      w /= sum;
+      sum2 += w*w;
+    }
+    mueff_ = 1./sum2;
+    cc_ = (4. + mueff_/n)/(n + 4. + 2.*mueff_/n);
+    cs_ = (mueff_ + 2.)/(n + mueff_ + 5.);
+    c1_ = 2./((n + 1.3)*(n + 1.3) + mueff_);
+    cmu_ = std::min(1. - c1_, 2.*(mueff_ - 2. + 1./mueff_)
+                    /((n + 2.)*(n + 2.) + mueff_));
+    if (is_separable_) {
+      c1_ *= (n + 2.)/3.;
+      cmu_ = std::min(1. - c1_, cmu_*(n + 2.)/3.);
+    }
+    damps_ = 1. + 2.*std::max(0., std::sqrt((mueff_ - 1.)/(n + 1.)) - 1.)
+      + cs_;
+    chiN_ = std::sqrt(n)*(1. - 1./(4.*n) + 1./(21.*n*n));
+  }  // end of void CMAES::SetLearningRates()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CMAES::UpdateEigensystem() {
+    const long n = dimension_;                                         // NOLINT
+    std::vector<double> values;
+    SymmetricEigen(n, C_, &B_, &values);
+    const double largest = *std::max_element(values.begin(), values.end());
+    for (long i = 0; i < n; ++i)                                       // NOLINT
+      D_[i] = std::sqrt(std::max(values[i], 1e-20*largest));
+    eigen_generation_ = generation_;
+  }  // end of void CMAES::UpdateEigensystem()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CMAES::GenoToPheno(const double *y, double *x) {
+    for (long c = 0; c < dimension_; ++c)                              // NOLINT
+      x[c] = lbound_[c] + (ubound_[c] - lbound_[c])
+        *LinQuad(y[c], 0., kGenoScale)/kGenoScale;
+  }  // end of void CMAES::GenoToPheno()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int CMAES::Descent(long lambda, double sigma) {                      // NOLINT
+    const long n = dimension_;                                         // NOLINT
+    lambda_ = lambda;
+    SetLearningRates();
+    mean_.resize(n);
+    for (auto &m : mean_) m = stream_.rand(0., kGenoScale);
+    pc_.assign(n, 0.);
+    ps_.assign(n, 0.);
+    D_.assign(n, 1.);
+    if (is_separable_) {
+      C_.assign(n, 1.);
+      B_.clear();
+    } else {
+      C_.assign(n*n, 0.);
+      for (long i = 0; i < n; ++i) C_[i*n + i] = 1.;                   // NOLINT
+      B_ = C_;
+    }
+    sigma_ = sigma;
+    generation_ = 0;
+    eigen_generation_ = 0;
+    best_history_.clear();
+    stop_reason_.clear();
+    std::vector<double> z(lambda*n), y(lambda*n), x(lambda*n), cost(lambda);
+    std::vector<double> old_mean(n), zw(n), step(n), Bz(n);
+    std::vector<long> ranked(lambda);                                  // NOLINT
+    while (true) {
+      if (!IsBudgetLeft(lambda)) {
+        stop_reason_ = kBudgetSpent;
+        break;
+      }
+      // Sample y = mean + sigma*B*D*z.
+      for (long k = 0; k < lambda; ++k) {                              // NOLINT
+        double *zk = &z[k*n], *yk = &y[k*n];
+        for (long i = 0; i < n; ++i) zk[i] = stream_.randn(0., 1.);   // NOLINT
+        for (long i = 0; i < n; ++i) {                                 // NOLINT
+          double s = D_[i]*zk[i];
+          if (!is_separable_) {
+            s = 0;
+            for (long j = 0; j < n; ++j) s += B_[i*n + j]*D_[j]*zk[j]; // NOLINT
+          }
+          yk[i] = mean_[i] + sigma_*s;
+        }
+        GenoToPheno(yk, &x[k*n]);
+      }  // end of sampling
+      EvaluateBatch(x, &cost);
+      std::iota(ranked.begin(), ranked.end(), 0);
+      std::stable_sort(ranked.begin(), ranked.end(),
+                       [&](long a, long b) {return cost[a] < cost[b];});  // NOLINT
+      // Recombination of the mu best.
+      old_mean = mean_;
+      std::fill(mean_.begin(), mean_.end(), 0.);
+      std::fill(zw.begin(), zw.end(), 0.);
+      for (long k = 0; k < mu_; ++k) {                                 // NOLINT
+        for (long i = 0; i < n; ++i) {                                 // NOLINT
+          mean_[i] += weights_[k]*y[ranked[k]*n + i];
+          zw[i] += weights_[k]*z[ranked[k]*n + i];
+        }
+      }
+      // Evolution paths, C^(-1/2)*(mean - old_mean)/sigma = B*zw.
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        Bz[i] = zw[i];
+        if (!is_separable_) {
+          Bz[i] = 0;
+          for (long j = 0; j < n; ++j) Bz[i] += B_[i*n + j]*zw[j];     // NOLINT
+        }
+      }
+      const double ps_factor = std::sqrt(cs_*(2. - cs_)*mueff_);
+      double ps_norm = 0;
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        ps_[i] = (1. - cs_)*ps_[i] + ps_factor*Bz[i];
+        ps_norm += ps_[i]*ps_[i];
+      }
+      ps_norm = std::sqrt(ps_norm);
+      const bool hsig = ps_norm/std::sqrt(1. - std::pow(1. - cs_, 2.*(generation_ + 1)))
+        /chiN_ < 1.4 + 2./(n + 1.);
+      const double pc_factor = hsig ? std::sqrt(cc_*(2. - cc_)*mueff_) : 0.;
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        step[i] = (mean_[i] - old_mean[i])/sigma_;
+        pc_[i] = (1. - cc_)*pc_[i] + pc_factor*step[i];
+      }
+      // Rank-one and rank-mu update of the covariance.
+      const double c1a = c1_*(1. - (hsig ? 0. : cc_*(2. - cc_)));
+      const double decay = 1. - c1a - cmu_;
+      if (is_separable_) {
+        for (long i = 0; i < n; ++i) {                                 // NOLINT
+          double rank_mu = 0;
+          for (long k = 0; k < mu_; ++k) {                             // NOLINT
+            const double d = (y[ranked[k]*n + i] - old_mean[i])/sigma_;
+            rank_mu += weights_[k]*d*d;
+          }
+          C_[i] = decay*C_[i] + c1_*pc_[i]*pc_[i] + cmu_*rank_mu;
+          D_[i] = std::sqrt(C_[i]);
+        }
+      } else {
+        for (long i = 0; i < n; ++i)                                   // NOLINT
+          for (long j = 0; j <= i; ++j)                                // NOLINT
+            C_[i*n + j] = decay*C_[i*n + j] + c1_*pc_[i]*pc_[j];
+        for (long k = 0; k < mu_; ++k) {                               // NOLINT
+          const double *yk = &y[ranked[k]*n];
+          const double w = cmu_*weights_[k]/(sigma_*sigma_);
+          for (long i = 0; i < n; ++i) {                               // NOLINT
+            const double di = w*(yk[i] - old_mean[i]);
+            for (long j = 0; j <= i; ++j)                              // NOLINT
+              C_[i*n + j] += di*(yk[j] - old_mean[j]);
+          }
+        }
+        for (long i = 0; i < n; ++i)                                   // NOLINT
+          for (long j = 0; j < i; ++j) C_[j*n + i] = C_[i*n + j];      // NOLINT
+      }  // end of covariance update
+      sigma_ *= std::exp(std::min(1., cs_/damps_*(ps_norm/chiN_ - 1.)));
+      ++generation_;
+      ++generations_;
+      if (!is_separable_ && generation_ - eigen_generation_
+          > lambda/(c1_ + cmu_)/n/10.)
+        UpdateEigensystem();
+      // Flat fitness, escape by a larger step.
+      if (cost[ranked[0]]
+          == cost[ranked[std::min(lambda - 1,
+                                     static_cast<long>(std::ceil(0.1 + lambda/4.)))]])  // NOLINT
+        sigma_ *= std::exp(0.2 + cs_/damps_);
+      if (CheckStop(cost, ranked)) break;
+    }  // end of generations
+    if (is_verbose_)
+      printf("CMA-ES descent %li: lambda %li, %li generations, best %g, "
+             "stop %s\n", restarts_, lambda_, generation_,
+             is_find_minimum_ ? best_cost_ : -best_cost_,
+             stop_reason_.c_str());
+    return kDone;
+  }  // end of int CMAES::Descent()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool CMAES::CheckStop(const std::vector<double> &cost,
+                        const std::vector<long> &ranked) {             // NOLINT
+    const long n = dimension_;                                         // NOLINT
+    const unsigned long history = 10                                   // NOLINT
+      + static_cast<unsigned long>(std::ceil(30.*n/lambda_));          // NOLINT
+    best_history_.push_back(cost[ranked.front()]);
+    if (best_history_.size() > history)
+      best_history_.erase(best_history_.begin());
+    const double worst = cost[ranked.back()], best = cost[ranked.front()];
+    const auto range = std::minmax_element(best_history_.begin(),
+                                           best_history_.end());
+    if (best_history_.size() == history && worst - best <= tol_fun_
+        && *range.second - *range.first <= tol_fun_) {
+      stop_reason_ = "tolfun";
+      return true;
+    }
+    bool is_tol_x = true, is_no_effect_coord = false;
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      const double c_ii = is_separable_ ? C_[i] : C_[i*n + i];
+      if (sigma_*std::max(std::abs(pc_[i]), std::sqrt(c_ii)) > tol_x_)
+        is_tol_x = false;
+      if (mean_[i] == mean_[i] + 0.2*sigma_*std::sqrt(c_ii))
+        is_no_effect_coord = true;
+    }
+    if (is_tol_x) {
+      stop_reason_ = "tolx";
+      return true;
+    }
+    if (is_no_effect_coord) {
+      stop_reason_ = "noeffectcoord";
+      return true;
+    }
+    const auto d = std::minmax_element(D_.begin(), D_.end());
+    if (*d.second > 1e7**d.first) {
+      stop_reason_ = "conditioncov";
+      return true;
+    }
+    if (!is_separable_) {
+      const long axis = generation_ % n;                               // NOLINT
+      bool is_no_effect_axis = true;
+      for (long i = 0; i < n; ++i)                                     // NOLINT
+        if (mean_[i] != mean_[i] + 0.1*sigma_*D_[axis]*B_[i*n + axis])
+          is_no_effect_axis = false;
+      if (is_no_effect_axis) {
+        stop_reason_ = "noeffectaxis";
+        return true;
+      }
+    }
+    if (!std::isfinite(sigma_) || !std::isfinite(best)) {
+      stop_reason_ = "numerics";
+      return true;
+    }
+    return false;
+  }  // end of bool CMAES::CheckStop()
+}  // end of namespace jade
@@ -0,0 +1,102 @@
+#ifndef SRC_CMAES_H_
+#define SRC_CMAES_H_
+///
+/// @file   cmaes.h
+/// @brief  CMA-ES (Nikolaus Hansen, 'The CMA evolution strategy: a
+/// tutorial', arXiv:1604.00772) with full or separable (Raymond Ros
+/// and Nikolaus Hansen, PPSN X, 2008) covariance, IPOP and BIPOP
+/// (Hansen, GECCO BBOB 2009) restarts and box constraints by the
+/// piecewise linear-quadratic geno/pheno mapping of lcmaes (pwqb).
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <functional>
+#include <string>
+#include <vector>
+#include "./optimizer.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief What CMAES::RunOptimization() does after a descent stops.
+  enum Restarts {
+    /// stop the run
+    kNoRestarts = 0,
+    /// restart with the population doubled
+    kIPOP,
+    /// interleave doubled populations with small ones of random size
+    /// and step, whichever regime has used fewer evaluations
+    kBIPOP
+  };  // end of enum Restarts
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief CMA-ES of a single process. The search runs in genotype
+  /// space where each bounded coordinate is scaled linearly to [0, 10]
+  /// and mapped back into the box by the pwqb transformation, so every
+  /// evaluated vector is feasible and no repair is needed. A whole
+  /// generation is evaluated as one batch.
+  class CMAES : public Optimizer {
+   public:
+    /// @brief Offspring per generation of the first descent, 0 -
+    /// 4 + 3 ln(dimension).
+    int SetPopulation(long lambda);                                    // NOLINT
+    /// @brief Initial step size in genotype units (the box is [0, 10]
+    /// in each coordinate), 2 by default.
+    int SetSigma(double sigma);
+    /// @brief Diagonal covariance, O(dimension) per sample instead of
+    /// O(dimension^2), learning rates are raised by (dimension + 2)/3.
+    void SetSeparable(bool is_separable) {is_separable_ = is_separable;}
+    int SetRestarts(Restarts restarts, long max_restarts);             // NOLINT
+    /// @brief A descent stops when the best fitness of the recent
+    /// generations ranges within tol_fun or the steps in all
+    /// coordinates are below tol_x (genotype units).
+    int SetTolerances(double tol_fun, double tol_x);
+    /// @brief Optimize until the budget is spent or the last descent
+    /// stops.
+    int RunOptimization() override;
+    long GetRestarts() {return restarts_;}                             // NOLINT
+    long GetPopulation() {return lambda_;}                             // NOLINT
+    /// @brief Why the last descent stopped.
+    std::string GetStopReason() {return stop_reason_;}
+
+   private:
+    int Descent(long lambda, double sigma);                            // NOLINT
+    void SetLearningRates();
+    void UpdateEigensystem();
+    bool CheckStop(const std::vector<double> &cost,
+                   const std::vector<long> &ranked);                   // NOLINT
+    void GenoToPheno(const double *y, double *x);
+    long lambda_default_ = 0, lambda_ = 0, mu_ = 0;                    // NOLINT
+    bool is_separable_ = false;
+    double sigma0_ = 2., tol_fun_ = 1e-12, tol_x_ = 1e-11;
+    Restarts restarts_kind_ = kNoRestarts;
+    long max_restarts_ = 0;                                            // NOLINT
+    // Strategy parameters of the current descent.
+    std::vector<double> weights_;
+    double mueff_ = 0, cc_ = 0, cs_ = 0, c1_ = 0, cmu_ = 0, damps_ = 0;
+    double chiN_ = 0;
+    // State of the current descent: mean, step, evolution paths,
+    // covariance C = B*diag(D^2)*B^T (only the diagonal of C and D
+    // for the separable variant).
+    std::vector<double> mean_, pc_, ps_, C_, B_, D_;
+    double sigma_ = 0;
+    long generation_ = 0, eigen_generation_ = 0;                       // NOLINT
+    std::vector<double> best_history_;
+    std::string stop_reason_;
+    long restarts_ = 0;                                                // NOLINT
+  };  // end of class CMAES
+}  // end of namespace jade
+#endif  // SRC_CMAES_H_
@@ -20,89 +20,533 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 
 #include "./matrix.h"
 #include "./sphereml.h"
+#include "./farfield.h"
+#include "./nearfield.h"
+#include "./directivity.h"
+#include "./evalstore.h"
 
 #include <math.h>
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <fstream>
 #include <memory.h>
 #include <vector>
 
-Vector evaluate_harmonics(const std::vector<double> &RL,
-                          const std::vector< std::complex<double> > &eL_in,
-                          const double &Rd, const double &wl,
-                          const double &px, const double &py, const double &pz,
-                          const int N = 41) {
-    int  NL, il, n, m, nm;
-    double /*dx, dz,*/ wv/*, kRs, tm*/;
-    Complex es, ris, kRd;
-    Vector VD1(2*N*N), VD2(2*N*N), VS2(2*N*N), E(3), ED(3), SM(3), SN(3), RC(2*N), VF(2);
+    // scattering matrices of all spherical interfaces; eL receives the layer permittivities
+    // (refractive indices squared, the host value is used as is). Released by the caller.
+static Matrix **interface_matrices(SphereML &MS, const std::vector<double> &RL,
+                                   const std::vector< std::complex<double> > &eL_in,
+                                   const double wv, Complex *eL) {
+    int NL = RL.size();
+    Matrix **M = new Matrix* [NL];
+    for (int i=0; i<NL+1; ++i) eL[i] = eL_in[i];
+    for (int i=0; i<NL; ++i) eL[i] *= eL[i];
+    for (int i=0; i<NL; ++i) {
+        M[i] = new Matrix(4,2*MS.N);
+        *M[i] = MS.calc_RT(wv*RL[i],eL[i],eL[i+1],1.,1.);
+    }
+    return M;
+}
+
+    // Scattering matrices of the multilayer reduce the dipole problem to per-harmonic factors:
+    // the scattered field outside is VS2 = (VD1*C1 + VD2)*C2, where VD1 and VD2 are the dipole
+    // expansions inside (calc_edz in=1) and outside (in=0) the dipole radius. For a dipole
+    // inside the smallest sphere C1 = 0 and VD1 is not needed (inner = true).
+static Complex dipole_transfer(const std::vector<double> &RL,
+                               const std::vector< std::complex<double> > &eL_in,
+                               const double &Rd, const double &wl, const int N,
+                               Vector &C1, Vector &C2, bool &inner) {
+    int  NL, il, n;
+    double wv;
+    Complex kRd;
     SphereML MS(N);
 
     wv = 2.*M_PI/wl;
 
-    memset(VS2.Data,0,2*N*N*sizeof(Complex));
-
         // initialize spherical multilayer:
     // we can place some variables on the stack in order to simplify memory management
     NL = RL.size(); 
-    double kRL[NL];
     Complex eL[NL+1];
     Matrix M1(4,2*N), M2(4,2*N), **M;
 
-    for (int i=0; i<NL+1; ++i) eL[i] = eL_in[i];
-    for (int i=0; i<NL; ++i) {kRL[i] = wv*RL[i]; eL[i] *= eL[i];}
-        // scattering matrices of all spherical interfaces:
-    M = new Matrix* [NL];
-    for (int i=0; i<NL; ++i) {
-        M[i] = new Matrix(4,2*N);
-        *M[i] = MS.calc_RT(kRL[i],eL[i],eL[i+1],1.,1.);
-    }
-    M2 = MS.calc_SML(M,NL); // initial scattering matrix
+    M = interface_matrices(MS, RL, eL_in, wv, eL);
     il = 0; // initial dipole position (inside the smallest sphere)
-    memset(M1.Data,0,8*N*sizeof(Complex));
-    
-    if (Rd < RL[0]) { // loop for dipole positions inside the smallest sphere
-        kRd = wv*Rd*sqrt(eL[0]); VD2 = MS.calc_edz(px,py,pz,kRd,0);
-        for (n=1; n<N; n++) for (m=-1; m<2; m+=2) {
-            nm = n*(n+1)+m; VS2.Data[nm] = VD2(nm)*M2(1,n); VS2.Data[nm+N*N] = VD2(nm+N*N)*M2(1,n+N);
-        }
+    C1 = Vector(2*N); C2 = Vector(2*N);
+    inner = false;
+
+    if (Rd < RL[0]) { // dipole inside the smallest sphere
+        M2 = MS.calc_SML(M,NL);
+        kRd = wv*Rd*sqrt(eL[0]); inner = true;
+        for (n=0; n<2*N; n++) {C1.Data[n] = 0.; C2.Data[n] = M2(1,n);}
     } else if (Rd < RL[NL-1]) { // dipole inside multilayer
         while (Rd > RL[il]) il++;
         M1 = MS.calc_SML(M,il); M2 = MS.calc_SML(M+il,NL-il);
-        kRd = wv*Rd*sqrt(eL[il]); VD1 = MS.calc_edz(px,py,pz,kRd,1); VD2 = MS.calc_edz(px,py,pz,kRd,0);
-        for (n=1; n<N; n++) for (m=-1; m<2; m+=2) {
-            nm = n*(n+1)+m;
-            VS2.Data[nm] = (VD1(nm)*M1(3,n) + VD2(nm))*M2(1,n)/(1.-M1(3,n)*M2(0,n));
-            VS2.Data[nm+N*N] = (VD1(nm+N*N)*M1(3,n+N) + VD2(nm+N*N))*M2(1,n+N)/(1.-M1(3,n+N)*M2(0,n+N));
-        }
+        kRd = wv*Rd*sqrt(eL[il]);
+        for (n=0; n<2*N; n++) {C1.Data[n] = M1(3,n); C2.Data[n] = M2(1,n)/(1.-M1(3,n)*M2(0,n));}
     } else {         // dipole outside the mutilayer
         M1 = MS.calc_SML(M,NL);
         kRd = wv*Rd*sqrt(eL[NL]);
-        VD1 = MS.calc_edz(px,py,pz,kRd,1);
-        VD2 = MS.calc_edz(px,py,pz,kRd,0);
-        for (n=1; n<N; n++)
-            for (m=-1; m<2; m+=2) {
-                nm = n*(n+1)+m;
-                VS2.Data[nm] = VD1(nm)*M1(3,n) + VD2(nm);
-                VS2.Data[nm+N*N] = VD1(nm+N*N)*M1(3,n+N) + VD2(nm+N*N);
-            }
+        for (n=0; n<2*N; n++) {C1.Data[n] = M1(3,n); C2.Data[n] = 1.;}
     }
 
     for (int i=0; i<NL; ++i) delete M[i];
     delete[] M; 
-    
+
+    return kRd;
+}
+
+    // applies the transfer factors to dipole expansions with |m| <= 1
+static Vector dipole_scattered(const Vector &VD1, const Vector &VD2,
+                               const Vector &C1, const Vector &C2, const bool inner, const int N) {
+    int n, m, nm;
+    Vector VS2(2*N*N);
+    memset(VS2.Data,0,2*N*N*sizeof(Complex));
+    for (n=1; n<N; n++) for (m=-1; m<2; m++) {
+        nm = n*(n+1)+m;
+        if (inner) {
+            VS2.Data[nm] = VD2(nm)*C2(n); VS2.Data[nm+N*N] = VD2(nm+N*N)*C2(n+N);
+        } else {
+            VS2.Data[nm] = (VD1(nm)*C1(n) + VD2(nm))*C2(n);
+            VS2.Data[nm+N*N] = (VD1(nm+N*N)*C1(n+N) + VD2(nm+N*N))*C2(n+N);
+        }
+    }
     return VS2;
 }
 
-double evaluate_directivity(const std::vector<double> &RL,
-                            const std::vector< std::complex<double> > &eL,
+    // numpy.isclose(a, b) with the default tolerances
+template <class T> static inline bool is_close(const T &a, const T &b) {
+    return std::abs(a - b) <= 1.e-8 + 1.e-5*std::abs(b);
+}
+
+bool canonical_design(std::vector<double> &RL,
+                      std::vector< std::complex<double> > &eL,
+                      const double &Rd) {
+    int i, NL = RL.size();
+    std::vector<double> R;
+    std::vector<Complex> e;
+    if (!std::is_sorted(RL.begin(), RL.end())) { // layers are (radius, index) pairs
+        std::vector< std::pair<double,Complex> > layers(NL);
+        for (i=0; i<NL; ++i) layers[i] = std::make_pair(RL[i], eL[i]);
+        std::stable_sort(layers.begin(), layers.end(),
+                         [](const std::pair<double,Complex> &a, const std::pair<double,Complex> &b)
+                         {return a.first < b.first;});
+        for (i=0; i<NL; ++i) {RL[i] = layers[i].first; eL[i] = layers[i].second;}
+    }
+    for (i=0; i<NL; ++i) {
+        if (is_close(R.empty() ? 0. : R.back(), RL[i])) continue; // no thickness
+        if (!e.empty() && is_close(e.back(), eL[i])) R.back() = RL[i]; // extends the layer below
+        else {R.push_back(RL[i]); e.push_back(eL[i]);}
+    }
+    while (!e.empty() && is_close(e.back(), eL[NL])) {R.pop_back(); e.pop_back();}
+    if (!R.empty()) {
+        e.push_back(eL[NL]);
+        RL.swap(R); eL.swap(e);
+    }
+    for (const auto r : RL) if (is_close(Rd, r)) return false;
+    return true;
+}
+
+bool decode_design(const double *x, const int NL,
+                   const std::complex<double> &host_index,
+                   std::vector<double> &RL,
+                   std::vector< std::complex<double> > &eL,
+                   double &Rd) {
+    Rd = x[0];
+    RL.assign(x+1, x+1+NL);
+    std::sort(RL.begin(), RL.end());
+    eL.resize(NL+1);
+    for (int i=0; i<NL; ++i) eL[i] = x[1+NL+i];
+    eL[NL] = host_index;
+    return canonical_design(RL, eL, Rd);
+}
+
+    // key of a dipole solve in the evaluation store, the design is canonical
+static std::vector<double> store_key(const std::vector<double> &RL,
+                                     const std::vector< std::complex<double> > &eL,
+                                     const double Rd, const double wl,
+                                     const double px, const double py, const double pz, const int N) {
+    std::vector<double> key = {double(N), double(RL.size()), Rd, wl, px, py, pz};
+    key.insert(key.end(), RL.begin(), RL.end());
+    for (const auto &e : eL) {key.push_back(e.real()); key.push_back(e.imag());}
+    return key;
+}
+
+Vector evaluate_harmonics(const std::vector<double> &RL_in,
+                          const std::vector< std::complex<double> > &eL_in,
+                          const double &Rd, const double &wl,
+                          const double &px, const double &py, const double &pz,
+                          const int N) {
+    bool inner;
+    Complex kRd;
+    Vector VD1(2*N*N), VD2(2*N*N), C1(2*N), C2(2*N), VS2;
+    SphereML MS(N);
+    EvalStore *store = eval_store();
+    std::vector<double> key, RL(RL_in);
+    std::vector< std::complex<double> > eL(eL_in);
+
+        // equivalent designs are solved (and stored) once, with fewer layers
+    canonical_design(RL, eL, Rd);
+    if (store) {
+        key = store_key(RL, eL, Rd, wl, px, py, pz, N);
+        if (store->get_harmonics(key, N, VS2)) return VS2;
+    }
+    kRd = dipole_transfer(RL, eL, Rd, wl, N, C1, C2, inner);
+    VD2 = MS.calc_edz(px,py,pz,kRd,0);
+    if (!inner) VD1 = MS.calc_edz(px,py,pz,kRd,1);
+    VS2 = dipole_scattered(VD1, VD2, C1, C2, inner, N);
+    if (store) store->put_harmonics(key, N, VS2);
+    return VS2;
+}
+
+void evaluate_harmonics_xyz(const std::vector<double> &RL,
+                            const std::vector< std::complex<double> > &eL_in,
+                            const double &Rd, const double &wl,
+                            Vector *VS,
+                            const int N) {
+    bool inner;
+    Complex kRd;
+    Vector VD1[3], VD2[3], C1(2*N), C2(2*N);
+    SphereML MS(N);
+
+    kRd = dipole_transfer(RL, eL_in, Rd, wl, N, C1, C2, inner);
+    MS.calc_edz_xyz(kRd,0,VD2);
+    if (!inner) MS.calc_edz_xyz(kRd,1,VD1);
+    for (int k=0; k<3; ++k) VS[k] = dipole_scattered(VD1[k], VD2[k], C1, C2, inner, N);
+}
+
+    // For a real dipole moment p the far-field intensity and the radiated power are quadratic
+    // forms p.A.p and p.B.p built from the basis responses (tC = 1 as in evaluate_directivity)
+static void orientation_forms(const Vector *VS, const double th, const double ph, const int N,
+                              double *A, double *B) {
+    int i, j, k, NN = N*N;
+    Complex F1[3], F2[3], tc;
+    for (i=0; i<3; ++i) FarField::field(VS[i], N, th, ph, F1[i], F2[i]);
+    for (i=0; i<3; ++i) for (j=i; j<3; ++j) {
+        A[3*i+j] = A[3*j+i] = (conj(F1[i])*F1[j] + conj(F2[i])*F2[j]).real();
+        tc = 0.;
+        for (k=1; k<NN; ++k) tc += conj(VS[i].Data[k])*VS[j].Data[k] + conj(VS[i].Data[NN+k])*VS[j].Data[NN+k];
+        B[3*i+j] = B[3*j+i] = 0.5*tc.real();
+    }
+}
+
+double directivity_xyz(const Vector *VS,
+                       const double &px, const double &py, const double &pz,
+                       const double th,
+                       const double ph,
+                       const int N) {
+    int i, j;
+    double A[9], B[9], p[3] = {px, py, pz}, ta = 0., tb = 0.;
+    orientation_forms(VS, th, ph, N, A, B);
+    for (i=0; i<3; ++i) for (j=0; j<3; ++j) {ta += p[i]*A[3*i+j]*p[j]; tb += p[i]*B[3*i+j]*p[j];}
+    return ta/tb;
+}
+
+    // isotropically oriented emitters: power-weighted average, i.e. the ratio of
+    // the orientation averages of the intensity and the power, tr(A)/tr(B)
+double averaged_directivity_xyz(const Vector *VS,
+                                const double th,
+                                const double ph,
+                                const int N) {
+    double A[9], B[9];
+    orientation_forms(VS, th, ph, N, A, B);
+    return (A[0] + A[4] + A[8])/(B[0] + B[4] + B[8]);
+}
+
+    // maximum of p.A.p/p.B.p over real p: largest eigenvalue of L^-1 A L^-T with B = L L^T;
+    // on return p holds the unit dipole orientation
+double optimal_directivity_xyz(const Vector *VS,
+                               double *p,
+                               const double th,
+                               const double ph,
+                               const int N) {
+    int i, j, k, it;
+    double A[9], B[9], L[9], C[9], T[9], Q[9], tv, tc, ts, tt;
+    orientation_forms(VS, th, ph, N, A, B);
+        // Cholesky decomposition of the power form
+    memset(L,0,9*sizeof(double));
+    for (j=0; j<3; ++j) {
+        tv = B[4*j];
+        for (k=0; k<j; ++k) tv -= L[3*j+k]*L[3*j+k];
+        if (tv <= 1.e-14*(B[0]+B[4]+B[8])) { // degenerate basis: fall back to the best axis
+            for (i=0, tt=-1.; i<3; ++i) if (A[4*i]/B[4*i] > tt) {tt = A[4*i]/B[4*i]; k = i;}
+            p[0] = p[1] = p[2] = 0.; p[k] = 1.;
+            return tt;
+        }
+        L[4*j] = sqrt(tv);
+        for (i=j+1; i<3; ++i) {
+            tv = B[3*i+j];
+            for (k=0; k<j; ++k) tv -= L[3*i+k]*L[3*j+k];
+            L[3*i+j] = tv/L[4*j];
+        }
+    }
+        // T = L^-1 A, C = T L^-T
+    for (j=0; j<3; ++j) for (i=0; i<3; ++i) {
+        tv = A[3*i+j];
+        for (k=0; k<i; ++k) tv -= L[3*i+k]*T[3*k+j];
+        T[3*i+j] = tv/L[4*i];
+    }
+    for (i=0; i<3; ++i) for (j=0; j<3; ++j) {
+        tv = T[3*i+j];
+        for (k=0; k<j; ++k) tv -= C[3*i+k]*L[3*j+k];
+        C[3*i+j] = tv/L[4*j];
+    }
+        // cyclic Jacobi rotations; Q accumulates the eigenvectors (columns)
+    memset(Q,0,9*sizeof(double)); Q[0] = Q[4] = Q[8] = 1.;
+    for (it=0; it<50; ++it) {
+        if (fabs(C[1]) + fabs(C[2]) + fabs(C[5]) < 1.e-15*(fabs(C[0]) + fabs(C[4]) + fabs(C[8]))) break;
+        for (i=0; i<2; ++i) for (j=i+1; j<3; ++j) {
+            if (C[3*i+j] == 0.) continue;
+            tv = 0.5*(C[4*j] - C[4*i])/C[3*i+j];
+            tt = ((tv >= 0.) ? 1. : -1.)/(fabs(tv) + sqrt(1. + tv*tv));
+            tc = 1./sqrt(1. + tt*tt); ts = tt*tc;
+            for (k=0; k<3; ++k) { // columns
+                tv = C[3*k+i]; C[3*k+i] = tc*tv - ts*C[3*k+j]; C[3*k+j] = ts*tv + tc*C[3*k+j];
+            }
+            for (k=0; k<3; ++k) { // rows
+                tv = C[3*i+k]; C[3*i+k] = tc*tv - ts*C[3*j+k]; C[3*j+k] = ts*tv + tc*C[3*j+k];
+            }
+            for (k=0; k<3; ++k) {
+                tv = Q[3*k+i]; Q[3*k+i] = tc*tv - ts*Q[3*k+j]; Q[3*k+j] = ts*tv + tc*Q[3*k+j];
+            }
+        }
+    }
+    k = 0; for (i=1; i<3; ++i) if (C[4*i] > C[4*k]) k = i;
+        // p = L^-T y
+    for (i=2; i>=0; --i) {
+        tv = Q[3*i+k];
+        for (j=i+1; j<3; ++j) tv -= L[3*j+i]*p[j];
+        p[i] = tv/L[4*i];
+    }
+    tv = sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+    for (i=0; i<3; ++i) p[i] /= tv;
+    return C[4*k];
+}
+
+double evaluate_directivity(const std::vector<double> &RL_in,
+                            const std::vector< std::complex<double> > &eL_in,
                             const double &Rd, const double &wl,
                             const double &px, const double &py, const double &pz,
-                            const double th=M_PI*0., // angle for directivity evaluation
-                            const double ph=0.,
-                            const int N = 41) {
+                            const double th, // angle for directivity evaluation
+                            const double ph,
+                            const int N) {
+    EvalStore *store = eval_store();
+    std::vector<double> key, RL(RL_in);
+    std::vector< std::complex<double> > eL(eL_in);
+    double D;
+    if (store) { // the harmonics are stored too, a new direction skips the solve
+        canonical_design(RL, eL, Rd);
+        key = store_key(RL, eL, Rd, wl, px, py, pz, N);
+        key.push_back(th); key.push_back(ph);
+        if (store->get_value(key, D)) return D;
+    }
     const Vector& VS2 = evaluate_harmonics(RL, eL, Rd, wl, px, py, pz, N);
     SphereML MS(N);
-    return MS.directivity(VS2,th,ph,1.);
+    D = MS.directivity(VS2,th,ph,1.);
+    if (store) store->put_value(key, D);
+    return D;
+}
+
+double evaluate_cone_efficiency(const std::vector<double> &RL,
+                                const std::vector< std::complex<double> > &eL,
+                                const double &Rd, const double &wl,
+                                const double &px, const double &py, const double &pz,
+                                const double th_cone, // half-angle of the cone around th=0
+                                const int N) {
+    const Vector& VS2 = evaluate_harmonics(RL, eL, Rd, wl, px, py, pz, N);
+    SphereML MS(N);
+    // N+1 Gauss-Legendre nodes integrate the cone exactly for the dipole harmonics
+    const auto FF = FarField::cached(N, 0., th_cone, N+1, FarField::max_order(VS2,N), true);
+    return FF->power(VS2)/(4.*M_PI*MS.calc_Psca(VS2,1.));
+}
+
+double evaluate_side_lobe_ratio(const std::vector<double> &RL,
+                                const std::vector< std::complex<double> > &eL,
+                                const double &Rd, const double &wl,
+                                const double &px, const double &py, const double &pz,
+                                const double th_main, // half-width of the main lobe around th=0
+                                const int N) {
+    const Vector& VS2 = evaluate_harmonics(RL, eL, Rd, wl, px, py, pz, N);
+    double th_max, ph_max;
+    const auto FF = FarField::cached(N, th_main, M_PI, 4*N, FarField::max_order(VS2,N), false);
+    return FF->intensity(VS2,0.,0.)/FF->max_intensity(VS2,16,th_max,ph_max);
+}
+
+Emission evaluate_emission(const std::vector<double> &RL,
+                           const std::vector< std::complex<double> > &eL,
+                           const double &Rd, const double &wl,
+                           const double &px, const double &py, const double &pz,
+                           const double th,
+                           const double ph,
+                           const int N) {
+    const Vector& VS2 = evaluate_harmonics(RL, eL, Rd, wl, px, py, pz, N);
+    SphereML MS(N);
+    Emission E;
+    E.D = MS.directivity(VS2,th,ph,1.);
+        // without the multilayer the outside field is the dipole expansion itself
+    const Vector& VD = MS.calc_edz(px,py,pz,2.*M_PI/wl*Rd*eL[RL.size()],0);
+    E.P = MS.calc_Psca(VS2,1.)/MS.calc_Psca(VD,1.);
+    return E;
+}
+
+Efficiencies evaluate_efficiencies(const std::vector<double> &RL,
+                                   const std::vector< std::complex<double> > &eL_in,
+                                   const double &wl,
+                                   const int N) {
+    int n, m, nm, NL = RL.size();
+    double wv = 2.*M_PI/wl, x, Psca;
+    Complex eL[NL+1], F1, F2;
+    Efficiencies Q;
+    Matrix S(4,2*N), **M;
+    SphereML MS(N);
+
+    M = interface_matrices(MS, RL, eL_in, wv, eL);
+    S = MS.calc_SML(M,NL);
+    for (int i=0; i<NL; ++i) delete M[i];
+    delete[] M;
+
+        // wave along z polarized along y (s amplitude of calc_pw): only m = +-1; the scattered
+        // wave is the outer-side reflection
+    Vector VI = MS.calc_pw(1.,0.,0.,0.), VS(2*N*N); // zero initialized
+    for (n=1; n<N; n++) for (m=-1; m<2; m+=2) {
+        nm = n*(n+1)+m;
+        VS.Data[nm] = VI(nm)*S(3,n); VS.Data[nm+N*N] = VI(nm+N*N)*S(3,n+N);
+    }
+
+    x = wv*RL[NL-1]*sqrt(eL[NL]).real(); // size parameter in the host medium
+    Psca = MS.calc_Psca(VS,1.);
+    Q.Qsca = 2.*Psca/(M_PI*x*x);
+    Q.Qext = MS.calc_Pext(VI,VS,1.)/(M_PI*x*x);
+    Q.Qabs = Q.Qext - Q.Qsca;
+        // radar backscattering efficiency: Q_sca times the directivity at th = pi
+    FarField::field(VS, N, M_PI, 0., F1, F2);
+    Q.Qback = Q.Qsca*(norm(F1) + norm(F2))/Psca;
+        // N+1 Gauss-Legendre nodes integrate cos(th)|F|^2 exactly
+    const auto FF = FarField::cached(N, 0., M_PI, N+1, 1, true);
+    Q.g = FF->power_cos(VS)/(4.*M_PI*Psca);
+    return Q;
+}
+
+void evaluate_efficiency_spectra(const std::vector<double> &RL,
+                                 const std::vector< std::complex<double> > &eL,
+                                 const int NL,
+                                 const std::vector<double> &wl,
+                                 std::vector<Efficiencies> &Q,
+                                 const int N) {
+    const long nd = RL.size()/NL, nwl = wl.size();
+    const bool dispersive = (long(eL.size()) == nd*nwl*(NL+1));
+    if (long(RL.size()) != nd*NL || (!dispersive && long(eL.size()) != nd*(NL+1))) {
+        cout<<"evaluate_efficiency_spectra: inconsistent sizes "<<RL.size()<<" "<<eL.size()<<" "<<NL<<endl;
+        Q.clear(); return;
+    }
+    Q.resize(nd*nwl);
+        // independent (design, wavelength) pairs; the cost grows with the size parameter
+#pragma omp parallel for schedule(dynamic)
+    for (long k=0; k<nd*nwl; ++k) {
+        const long id = k/nwl, iw = k%nwl;
+        const long ie = dispersive ? k*(NL+1) : id*(NL+1);
+        std::vector<double> RLk(RL.begin()+id*NL, RL.begin()+(id+1)*NL);
+        std::vector< std::complex<double> > eLk(eL.begin()+ie, eL.begin()+ie+NL+1);
+        Q[k] = evaluate_efficiencies(RLk, eLk, wl[iw], N);
+    }
+}
+
+    // reflection coefficients of the inner interfaces seen from layer l (a_l -> b_l) and of the
+    // outer ones (b_l -> a_l), adding one interface at a time; index l*2N + column
+static void stack_reflections(Matrix **M, const int NL, const int N,
+                              std::vector<Complex> &Rin, std::vector<Complex> &Rout) {
+    int l, n;
+    Complex R;
+    Rin.assign((NL+1)*2*N, 0.); Rout.assign((NL+1)*2*N, 0.);
+    for (l=0; l<NL; ++l) for (n=0; n<2*N; ++n) {
+        const Matrix &S = *M[l]; R = Rin[l*2*N+n];
+        Rin[(l+1)*2*N+n] = S(3,n) + S(1,n)*R*S(2,n)/(1.-S(0,n)*R);
+    }
+    for (l=NL-1; l>=0; --l) for (n=0; n<2*N; ++n) {
+        const Matrix &S = *M[l]; R = Rout[(l+1)*2*N+n];
+        Rout[l*2*N+n] = S(0,n) + S(2,n)*R*S(1,n)/(1.-S(3,n)*R);
+    }
+}
+
+    // column of the interface matrices for a coefficient index (n for M, n+N for N waves)
+static inline int harmonic_column(const int i, const int N) {
+    return int(sqrt(i%(N*N)+0.5)) + (i/(N*N))*N;
+}
+
+    // regular (A) and outgoing (B) amplitudes in every layer for a dipole at Rd (dipole == true)
+    // or for the plane wave of evaluate_efficiencies. Starting from the source layer the
+    // amplitudes are carried inwards and outwards through single interfaces closed by the
+    // stack reflections, which avoids the unstable inversion of transmission coefficients.
+static FieldExpansion layer_expansion(const std::vector<double> &RL,
+                                      const std::vector< std::complex<double> > &eL_in,
+                                      const double &wl, const int N, const bool dipole,
+                                      const double &Rd, const double &px, const double &py, const double &pz) {
+    int NL = RL.size(), NN = N*N, il, l, q, i, c, nq;
+    double wv = 2.*M_PI/wl;
+    Complex eL[NL+1], kl, R1, R2;
+    std::vector<Complex> Rin, Rout;
+    SphereML MS(N);
+    Matrix **M = interface_matrices(MS, RL, eL_in, wv, eL);
+    FieldExpansion FE;
+
+    stack_reflections(M, NL, N, Rin, Rout);
+    il = NL; // source layer
+    if (dipole) {il = 0; while (il < NL && Rd >= RL[il]) il++;}
+    nq = dipole ? NL+2 : NL+1; // the dipole layer is split at Rd
+    FE.N = N;
+    FE.A.assign(nq, Vector(2*NN)); FE.B.assign(nq, Vector(2*NN));
+    for (q=0; q<nq; ++q) {
+        l = (dipole && q > il) ? q-1 : q;
+        kl = sqrt(eL[l]); if (arg(kl) < -1.e-8) kl = -kl; // branch of calc_RT
+        FE.ri.push_back(kl); FE.k.push_back(wv*kl);
+        if (q < nq-1) FE.R.push_back((dipole && q == il) ? Rd : RL[l]);
+    }
+
+    if (dipole) {
+        Complex kRd = wv*Rd*sqrt(eL[il]);
+        Vector VD1 = MS.calc_edz(px,py,pz,kRd,1), VD2 = MS.calc_edz(px,py,pz,kRd,0);
+        for (i=0; i<2*NN; ++i) {
+            c = harmonic_column(i,N); R1 = Rin[il*2*N+c]; R2 = Rout[il*2*N+c];
+            Complex &ai = FE.A[il].Data[i], &bi = FE.B[il].Data[i], &ao = FE.A[il+1].Data[i], &bo = FE.B[il+1].Data[i];
+            bo = (R1*VD1(i) + VD2(i))/(1.-R1*R2); ao = R2*bo; // r > Rd
+            ai = ao + VD1(i); bi = R1*ai;                      // r < Rd
+        }
+            // outwards: b_l = S01 b_(l-1)/(1 - S11 Rout_l), a_l = Rout_l b_l
+        for (l=il+1; l<NL+1; ++l) for (i=0; i<2*NN; ++i) {
+            c = harmonic_column(i,N); const Matrix &S = *M[l-1]; R2 = Rout[l*2*N+c];
+            FE.B[l+1].Data[i] = S(1,c)*FE.B[l].Data[i]/(1.-S(3,c)*R2);
+            FE.A[l+1].Data[i] = R2*FE.B[l+1].Data[i];
+        }
+    } else {
+        Vector VI = MS.calc_pw(1.,0.,0.,0.);
+        for (i=0; i<2*NN; ++i) {
+            c = harmonic_column(i,N);
+            FE.A[NL].Data[i] = VI(i); FE.B[NL].Data[i] = Rin[NL*2*N+c]*VI(i);
+        }
+    }
+        // inwards: a_l = S10 a_(l+1)/(1 - S00 Rin_l), b_l = Rin_l a_l
+    for (l=il-1; l>=0; --l) for (i=0; i<2*NN; ++i) {
+        c = harmonic_column(i,N); const Matrix &S = *M[l]; R1 = Rin[l*2*N+c];
+        FE.A[l].Data[i] = S(2,c)*FE.A[l+1].Data[i]/(1.-S(0,c)*R1);
+        FE.B[l].Data[i] = R1*FE.A[l].Data[i];
+    }
+
+    for (l=0; l<NL; ++l) delete M[l];
+    delete[] M;
+    return FE;
+}
+
+FieldExpansion evaluate_field_expansion(const std::vector<double> &RL,
+                                        const std::vector< std::complex<double> > &eL_in,
+                                        const double &Rd, const double &wl,
+                                        const double &px, const double &py, const double &pz,
+                                        const int N) {
+    return layer_expansion(RL, eL_in, wl, N, true, Rd, px, py, pz);
+}
+
+FieldExpansion evaluate_plane_wave_expansion(const std::vector<double> &RL,
+                                             const std::vector< std::complex<double> > &eL_in,
+                                             const double &wl,
+                                             const int N) {
+    return layer_expansion(RL, eL_in, wl, N, false, 0., 0., 0., 0.);
 }
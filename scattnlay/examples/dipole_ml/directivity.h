@@ -22,6 +22,7 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 
 #include "./matrix.h"
 #include "./sphereml.h"
+#include "./nearfield.h"
 
 #include <cmath>
 #include <complex>
@@ -38,6 +39,34 @@ Vector evaluate_harmonics(const std::vector<double> &RL,
                           const double &px, const double &py, const double &pz,
                           const int N = 41);
 
+// scattered harmonics of the unit x, y and z dipoles at Rd from a single multilayer solve:
+// evaluate_harmonics(px,py,pz) = px*VS[0] + py*VS[1] + pz*VS[2]
+void evaluate_harmonics_xyz(const std::vector<double> &RL,
+                            const std::vector< std::complex<double> > &eL_in,
+                            const double &Rd, const double &wl,
+                            Vector *VS, // VS[3]
+                            const int N = 41);
+
+// directivity of a dipole with an arbitrary real moment from the basis harmonics
+double directivity_xyz(const Vector *VS,
+                       const double &px, const double &py, const double &pz,
+                       const double th=M_PI*0.,
+                       const double ph=0.,
+                       const int N = 41);
+
+// directivity of randomly oriented dipoles (incoherent, equal dipole strength)
+double averaged_directivity_xyz(const Vector *VS,
+                                const double th=M_PI*0.,
+                                const double ph=0.,
+                                const int N = 41);
+
+// maximum directivity over real dipole orientations, the unit orientation is returned in p[3]
+double optimal_directivity_xyz(const Vector *VS,
+                               double *p,
+                               const double th=M_PI*0.,
+                               const double ph=0.,
+                               const int N = 41);
+
 double evaluate_directivity(const std::vector<double> &RL_in,
                             const std::vector< std::complex<double> > &eL_in,
                             const double &Rd, const double &wl,
@@ -45,4 +74,86 @@ double evaluate_directivity(const std::vector<double> &RL_in,
                             const double th=M_PI*0., // angle for directivity evaluation
                             const double ph=0.,
                             const int N = 41);
+
+// plane-wave efficiencies of the multilayer (normalized by the geometric cross section of the
+// outer sphere) and the asymmetry parameter
+struct Efficiencies {
+    double Qsca, Qext, Qabs, Qback, g;
+};
+
+// plane wave incident along z, E along y; N should exceed x + 4x^(1/3) + 2 for the host size parameter x
+Efficiencies evaluate_efficiencies(const std::vector<double> &RL,
+                                   const std::vector< std::complex<double> > &eL_in,
+                                   const double &wl,
+                                   const int N = 41);
+
+// nd designs of NL layers (RL: nd*NL radii, eL: nd*(NL+1) values or nd*nwl*(NL+1) for
+// dispersive materials) at nwl wavelengths; Q[id*nwl + iw], evaluated with OpenMP threads
+void evaluate_efficiency_spectra(const std::vector<double> &RL,
+                                 const std::vector< std::complex<double> > &eL,
+                                 const int NL,
+                                 const std::vector<double> &wl,
+                                 std::vector<Efficiencies> &Q,
+                                 const int N = 41);
+
+// field amplitudes in every layer (the dipole layer is split at Rd) for near-field maps with
+// evaluate_fields; the total field including the dipole itself is represented
+FieldExpansion evaluate_field_expansion(const std::vector<double> &RL,
+                                        const std::vector< std::complex<double> > &eL_in,
+                                        const double &Rd, const double &wl,
+                                        const double &px, const double &py, const double &pz,
+                                        const int N = 41);
+
+// the same for the plane wave of evaluate_efficiencies (incident plus scattered field outside)
+FieldExpansion evaluate_plane_wave_expansion(const std::vector<double> &RL,
+                                             const std::vector< std::complex<double> > &eL_in,
+                                             const double &wl,
+                                             const int N = 41);
+
+// fraction of the radiated power inside the cone th < th_cone
+double evaluate_cone_efficiency(const std::vector<double> &RL_in,
+                                const std::vector< std::complex<double> > &eL_in,
+                                const double &Rd, const double &wl,
+                                const double &px, const double &py, const double &pz,
+                                const double th_cone=M_PI/6.,
+                                const int N = 41);
+
+// directivity at th=0 over the maximum directivity at th >= th_main
+double evaluate_side_lobe_ratio(const std::vector<double> &RL_in,
+                                const std::vector< std::complex<double> > &eL_in,
+                                const double &Rd, const double &wl,
+                                const double &px, const double &py, const double &pz,
+                                const double th_main=M_PI/6.,
+                                const int N = 41);
+
+// directivity in (th, ph) and the radiated power from a single solve; the power is the far-field
+// one over that of the same dipole in the unbounded host medium (Purcell-like factor)
+struct Emission {
+    double D, P;
+};
+
+Emission evaluate_emission(const std::vector<double> &RL_in,
+                           const std::vector< std::complex<double> > &eL_in,
+                           const double &Rd, const double &wl,
+                           const double &px, const double &py, const double &pz,
+                           const double th=M_PI*0.,
+                           const double ph=0.,
+                           const int N = 41);
+
+// Canonical form of a design, equivalent designs get the same arrays: the layers are sorted by
+// radius, a layer thinner than the numpy.isclose tolerance (a core of zero radius, a shell
+// between near-coincident interfaces) is dropped, neighbours with equal indices (numpy.isclose)
+// are merged and so is an outer layer of the host index. A design reduced to the host medium
+// is left as it is. Returns false if the dipole is on an interface of the canonical design.
+bool canonical_design(std::vector<double> &RL,
+                      std::vector< std::complex<double> > &eL,
+                      const double &Rd);
+
+// design of the optimizers x = [Rd, R1..RNL, n1..nNL] as in fitness2() of optimize.py: the
+// radii are sorted (the indices keep their order) and the design made canonical
+bool decode_design(const double *x, const int NL,
+                   const std::complex<double> &host_index,
+                   std::vector<double> &RL,
+                   std::vector< std::complex<double> > &eL,
+                   double &Rd);
 #endif
\ No newline at end of file
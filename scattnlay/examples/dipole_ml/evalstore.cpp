@@ -0,0 +1,233 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "evalstore.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+     // slots are shared by processes, their atomics must not hide a lock
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the store needs lock-free 64-bit atomics");
+
+static const char store_magic[8] = {'S','M','L','S','T','O','R','1'};
+static const uint64_t slot_empty = 0, slot_busy = 1;
+
+struct EvalStore::Header {
+     char magic[8];
+     uint64_t slots, data_bytes;
+     std::atomic<uint64_t> entries, data_end;
+     char pad[24];
+};
+
+struct EvalStore::Slot {
+     std::atomic<uint64_t> h1;   // slot_empty, slot_busy or the first key hash
+     uint64_t h2;                // second key hash
+     double value;
+     uint64_t offset;            // harmonic record in the data region + 1, 0 - none
+};
+
+     // splitmix64 finalizer
+static inline uint64_t mix(uint64_t z) {
+     z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+     z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+     return z ^ (z >> 31);
+}
+
+     // two independent 64-bit hashes of the key bits; kind separates values from harmonics
+static void hash_key(const std::vector<double> &key, uint64_t kind, uint64_t &h1, uint64_t &h2) {
+     uint64_t w;
+     double x;
+     h1 = mix(kind + 0x9e3779b97f4a7c15ULL); h2 = mix(kind + 0x632be59bd9b4e019ULL);
+     for (size_t i=0; i<key.size(); ++i) {
+          x = key[i] + 0.; // -0 is 0
+          memcpy(&w, &x, sizeof(w));
+          h1 = mix(h1 + w);
+          h2 = mix((h2 ^ w)*0xd6e8feb86659fd93ULL + i);
+     }
+     if (h1 <= slot_busy) h1 += 2;
+}
+
+     // harmonics n=1..N-1, m=-1..1 of both polarizations
+static inline size_t harmonic_count(int N) {return 6*size_t(N-1);}
+
+EvalStore::EvalStore(const std::string &file, long nslots, long data_mb) {
+     static_assert(sizeof(Header) == 64 && sizeof(Slot) == 32, "unexpected store layout");
+     if (nslots < 16 || data_mb < 1) throw std::invalid_argument("Store needs slots >= 16 and data_mb >= 1!");
+     uint64_t ns = 16, nd;
+     char buf[sizeof(Header)], zero[8] = {0};
+     struct stat st;
+     while (ns < uint64_t(nslots)) ns <<= 1;
+     fd = ::open(file.c_str(), O_RDWR|O_CREAT, 0644);
+     if (fd < 0) throw std::runtime_error("Cannot open the store " + file);
+          // the lock only serializes creation, lookups and appends take none
+     flock(fd, LOCK_EX);
+     fstat(fd, &st);
+          // the magic is written last, a file without it was left by a creator that did not finish
+     bool is_new = (st.st_size == 0);
+     if (!is_new && st.st_size >= off_t(sizeof(Header)) && pread(fd, buf, sizeof(buf), 0) == ssize_t(sizeof(buf)))
+          is_new = !memcmp(buf, zero, 8);
+     if (is_new) {
+          nd = uint64_t(data_mb) << 20;
+          bytes = sizeof(Header) + ns*sizeof(Slot) + nd;
+          if (ftruncate(fd, 0) != 0 || ftruncate(fd, bytes) != 0) { // zero filled
+               flock(fd, LOCK_UN); ::close(fd);
+               throw std::runtime_error("Cannot allocate the store " + file);
+          }
+     } else {
+          if (pread(fd, buf, sizeof(buf), 0) != ssize_t(sizeof(buf)) || memcmp(buf, store_magic, 8)) {
+               flock(fd, LOCK_UN); ::close(fd);
+               throw std::runtime_error("Not a store file " + file);
+          }
+          memcpy(&ns, buf + 8, 8); memcpy(&nd, buf + 16, 8);
+          bytes = sizeof(Header) + ns*sizeof(Slot) + nd;
+          if (uint64_t(st.st_size) != bytes) {
+               flock(fd, LOCK_UN); ::close(fd);
+               throw std::runtime_error("Truncated store file " + file);
+          }
+     }
+     base = static_cast<char*>(mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+     if (base == MAP_FAILED) {
+          flock(fd, LOCK_UN); ::close(fd);
+          throw std::runtime_error("Cannot map the store " + file);
+     }
+     header = reinterpret_cast<Header*>(base);
+     slots = reinterpret_cast<Slot*>(base + sizeof(Header));
+     data = base + sizeof(Header) + ns*sizeof(Slot);
+     if (is_new) { // the file is zero filled: all slots are empty
+          header->slots = ns; header->data_bytes = nd;
+          memcpy(header->magic, store_magic, 8);
+     }
+     flock(fd, LOCK_UN);
+}
+
+EvalStore::~EvalStore() {
+     munmap(base, bytes);
+     ::close(fd);
+}
+
+const EvalStore::Slot *EvalStore::find(uint64_t h1, uint64_t h2) const {
+     uint64_t i, k, t, mask = header->slots - 1;
+     for (i=h1&mask, k=0; k<header->slots; i=(i+1)&mask, ++k) {
+          t = slots[i].h1.load(std::memory_order_acquire);
+          if (t == slot_empty) return nullptr;
+          if (t == h1 && slots[i].h2 == h2) return &slots[i];
+     }
+     return nullptr;
+}
+
+     // an empty slot marked busy, nullptr if the key is stored already or the table is full;
+     // slots being written by others are passed by, at worst a key is stored twice
+EvalStore::Slot *EvalStore::claim(uint64_t h1, uint64_t h2) {
+     uint64_t i, k, t, mask = header->slots - 1;
+     if (header->entries.load(std::memory_order_relaxed) >= header->slots/4*3) return nullptr;
+     for (i=h1&mask, k=0; k<header->slots; i=(i+1)&mask, ++k) {
+          t = slots[i].h1.load(std::memory_order_acquire);
+          if (t == slot_empty &&
+              slots[i].h1.compare_exchange_strong(t, slot_busy, std::memory_order_acq_rel)) return &slots[i];
+          if (t == h1 && slots[i].h2 == h2) return nullptr;
+     }
+     return nullptr;
+}
+
+     // the hash is stored last, readers acquire it with the rest of the slot
+void EvalStore::publish(Slot *slot, uint64_t h1) {
+     header->entries.fetch_add(1, std::memory_order_relaxed);
+     slot->h1.store(h1, std::memory_order_release);
+}
+
+bool EvalStore::get_value(const std::vector<double> &key, double &value) const {
+     uint64_t h1, h2;
+     hash_key(key, 1, h1, h2);
+     const Slot *slot = find(h1, h2);
+     if (!slot) return false;
+     value = slot->value;
+     return true;
+}
+
+void EvalStore::put_value(const std::vector<double> &key, double value) {
+     uint64_t h1, h2;
+     hash_key(key, 1, h1, h2);
+     Slot *slot = claim(h1, h2);
+     if (!slot) return;
+     slot->h2 = h2; slot->value = value; slot->offset = 0;
+     publish(slot, h1);
+}
+
+bool EvalStore::get_harmonics(const std::vector<double> &key, int N, Vector &VS) const {
+     int n, m, nm, NN = N*N;
+     uint64_t h1, h2;
+     if (N < 2) return false;
+     hash_key(key, 2, h1, h2);
+     const Slot *slot = find(h1, h2);
+     if (!slot || !slot->offset) return false;
+     const Complex *tc = reinterpret_cast<const Complex*>(data + slot->offset - 1);
+     VS = Vector(2*NN); // zero initialized
+     for (n=1; n<N; ++n) for (m=-1; m<2; ++m) {
+          nm = n*(n+1)+m;
+          VS.Data[nm] = *tc++; VS.Data[NN+nm] = *tc++;
+     }
+     return true;
+}
+
+void EvalStore::put_harmonics(const std::vector<double> &key, int N, const Vector &VS) {
+     int n, m, nm, NN = N*N;
+     uint64_t h1, h2, offset;
+     if (N < 2) return;
+     hash_key(key, 2, h1, h2);
+     Slot *slot = claim(h1, h2);
+     if (!slot) return;
+     const uint64_t record = harmonic_count(N)*sizeof(Complex);
+     offset = header->data_end.fetch_add(record, std::memory_order_relaxed);
+     slot->h2 = h2; slot->value = 0.; slot->offset = 0;
+     if (offset + record <= header->data_bytes) { // otherwise the slot only marks the key
+          Complex *tc = reinterpret_cast<Complex*>(data + offset);
+          for (n=1; n<N; ++n) for (m=-1; m<2; ++m) {
+               nm = n*(n+1)+m;
+               *tc++ = VS.Data[nm]; *tc++ = VS.Data[NN+nm];
+          }
+          slot->offset = offset + 1;
+     }
+     publish(slot, h1);
+}
+
+long EvalStore::entries() const {
+     return header->entries.load(std::memory_order_relaxed);
+}
+
+static std::unique_ptr<EvalStore> global_store;
+
+void open_eval_store(const std::string &file, long slots, long data_mb) {
+     global_store.reset(new EvalStore(file, slots, data_mb));
+}
+
+void close_eval_store() {
+     global_store.reset();
+}
+
+EvalStore *eval_store() {
+     return global_store.get();
+}
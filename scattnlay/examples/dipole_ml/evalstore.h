@@ -0,0 +1,71 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef _EVALSTORE_H
+#define _EVALSTORE_H
+
+#include "matrix.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+     // Persistent memo of solved designs in a memory-mapped file shared by all processes that
+     // open it: a key (layers, Rd, wl, dipole, N) maps to the dipole harmonics (the |m| <= 1
+     // part, the rest is zero) and a key with the direction (th, ph) to the directivity.
+     // The file holds a fixed open-addressing table of 128-bit key hashes and a data region of
+     // harmonic records. Lookups take no locks; a writer claims an empty slot by compare-and-
+     // swap, reserves its record with an atomic counter and publishes the slot hash last, so a
+     // reader sees complete entries only. A full store (3/4 of the slots or the data region
+     // used) keeps its entries and ignores new ones.
+class EvalStore {
+public:
+          // opens the file or creates it with the given size (an existing file keeps its own); the
+          // defaults make a sparse file of 1 GiB data and 32 MiB slots
+     EvalStore(const std::string &file, long slots = 1L<<20, long data_mb = 1024);
+     ~EvalStore();
+
+     bool get_value(const std::vector<double> &key, double &value) const;
+     void put_value(const std::vector<double> &key, double value);
+     bool get_harmonics(const std::vector<double> &key, int N, Vector &VS) const;
+     void put_harmonics(const std::vector<double> &key, int N, const Vector &VS);
+     long entries() const;
+
+private:
+     struct Header;
+     struct Slot;
+     const Slot *find(uint64_t h1, uint64_t h2) const;
+     Slot *claim(uint64_t h1, uint64_t h2);
+     void publish(Slot *slot, uint64_t h1);
+
+     int fd;
+     size_t bytes;
+     char *base;
+     Header *header;
+     Slot *slots;
+     char *data;
+};
+
+     // process-wide store consulted by evaluate_harmonics and evaluate_directivity (none by
+     // default); open and close it outside of parallel evaluations
+void open_eval_store(const std::string &file, long slots = 1L<<20, long data_mb = 1024);
+void close_eval_store();
+EvalStore *eval_store();
+
+#endif
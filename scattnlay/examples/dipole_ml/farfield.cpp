@@ -0,0 +1,170 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "farfield.h"
+#include "spfunc.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+     // sums over n for m=0..mmax with tables tp[m*N+n], tt[m*N+n] at a single polar angle;
+     // negative m use pi_n^-m = -(-1)^m pi_n^m and tau_n^-m = (-1)^m tau_n^m
+static void sum_harmonics(const Vector &VS, int N, int mmax, const double *tp, const double *tt,
+                          Complex *F1, Complex *F2) {
+     int n, m, nm, NN = N*N; double sg;
+     Complex tc, tcc, ta, tb;
+     for (m=0; m<2*mmax+1; ++m) F1[m] = F2[m] = 0.;
+     for (m=0; m<mmax+1; ++m) {
+          sg = (m%2) ? -1. : 1.; tc = -j_;
+          for (n=1; n<N; ++n) {
+               if (n >= m) {
+                    tcc = tc/sqrt(n*(n+1.)); nm = n*(n+1);
+                    ta = VS.Data[nm+m]; tb = VS.Data[NN+nm+m];
+                    F1[mmax+m] += tcc*(ta*tp[m*N+n] + tb*tt[m*N+n]);
+                    F2[mmax+m] += tcc*(ta*tt[m*N+n] + tb*tp[m*N+n]);
+                    if (m > 0) {
+                         ta = VS.Data[nm-m]; tb = VS.Data[NN+nm-m];
+                         F1[mmax-m] += sg*tcc*(tb*tt[m*N+n] - ta*tp[m*N+n]);
+                         F2[mmax-m] += sg*tcc*(ta*tt[m*N+n] - tb*tp[m*N+n]);
+                    }
+               }
+               tc *= -j_;
+          }
+     }
+}
+
+FarField::FarField(int N_, double th1, double th2, int Nth_, int Mmax_, bool quadrature) {
+     int it, m;
+     std::vector<double> P(N_);
+     N = N_; Nth = Nth_; Mmax = (Mmax_ < N_) ? Mmax_ : N_-1;
+     th.resize(Nth); tp.resize(Nth*(Mmax+1)*N); tt.resize(Nth*(Mmax+1)*N);
+     if (quadrature) {
+          wt.resize(Nth);
+          gauss_legendre(Nth, cos(th2), cos(th1), th.data(), wt.data());
+          for (it=0; it<Nth; ++it) th[it] = acos(th[it]);
+     }
+     else for (it=0; it<Nth; ++it) th[it] = (Nth > 1) ? th1 + (th2-th1)*it/(Nth-1.) : th1;
+     for (it=0; it<Nth; ++it) for (m=0; m<Mmax+1; ++m)
+          legendre_pitau(th[it], N, m, P.data(), &tp[(it*(Mmax+1)+m)*N], &tt[(it*(Mmax+1)+m)*N]);
+}
+
+std::shared_ptr<const FarField> FarField::cached(int N, double th1, double th2, int Nth, int Mmax, bool quadrature) {
+     typedef std::tuple<int, double, double, int, int, bool> Key;
+     static std::map<Key, std::shared_ptr<const FarField> > grids;
+     static std::mutex guard;
+     Key key(N, th1, th2, Nth, Mmax, quadrature);
+     std::lock_guard<std::mutex> lock(guard);
+     auto it = grids.find(key);
+     if (it != grids.end()) return it->second;
+     if (grids.size() > 64) grids.clear(); // grids in use stay alive through their owners
+     std::shared_ptr<const FarField> FF(new FarField(N, th1, th2, Nth, Mmax, quadrature));
+     grids[key] = FF;
+     return FF;
+}
+
+int FarField::max_order(const Vector &VS, int N) {
+     int n, m, NN = N*N, mmax = 0;
+     for (n=1; n<N; ++n) for (m=mmax+1; m<n+1; ++m) {
+          if ( VS.Data[n*(n+1)+m] != 0. || VS.Data[n*(n+1)-m] != 0.
+               || VS.Data[NN+n*(n+1)+m] != 0. || VS.Data[NN+n*(n+1)-m] != 0. ) mmax = m;
+     }
+     return mmax;
+}
+
+void FarField::amplitudes(const Vector &VS, int it, int mmax, Complex *F1, Complex *F2) const {
+     if (mmax > Mmax) {cout<<"FarField: expansion order "<<mmax<<" exceeds the table "<<Mmax<<endl; mmax = Mmax;}
+     sum_harmonics(VS, N, mmax, &tp[it*(Mmax+1)*N], &tt[it*(Mmax+1)*N], F1, F2);
+}
+
+double FarField::power(const Vector &VS) const {
+     int it, m, mmax = std::min(max_order(VS,N), Mmax);
+     double tv = 0.;
+     std::vector<Complex> F1(2*mmax+1), F2(2*mmax+1);
+     for (it=0; it<Nth; ++it) {
+          amplitudes(VS, it, mmax, F1.data(), F2.data());
+          for (m=0; m<2*mmax+1; ++m) tv += wt[it]*(norm(F1[m]) + norm(F2[m]));
+     }
+     return 2.*M_PI*tv;
+}
+
+double FarField::power_cos(const Vector &VS) const {
+     int it, m, mmax = std::min(max_order(VS,N), Mmax);
+     double tv = 0.;
+     std::vector<Complex> F1(2*mmax+1), F2(2*mmax+1);
+     for (it=0; it<Nth; ++it) {
+          amplitudes(VS, it, mmax, F1.data(), F2.data());
+          for (m=0; m<2*mmax+1; ++m) tv += wt[it]*cos(th[it])*(norm(F1[m]) + norm(F2[m]));
+     }
+     return 2.*M_PI*tv;
+}
+
+void FarField::field(const Vector &VS, int N, double t, double ph, Complex &tc1, Complex &tc2) {
+     int m, mmax = max_order(VS,N);
+     std::vector<double> P(N), tpl((mmax+1)*N), ttl((mmax+1)*N);
+     std::vector<Complex> F1(2*mmax+1), F2(2*mmax+1);
+     Complex te;
+     for (m=0; m<mmax+1; ++m) legendre_pitau(t, N, m, P.data(), &tpl[m*N], &ttl[m*N]);
+     sum_harmonics(VS, N, mmax, tpl.data(), ttl.data(), F1.data(), F2.data());
+     tc1 = tc2 = 0.;
+     for (m=-mmax; m<mmax+1; ++m) {
+          te = exp(j_*double(m)*ph);
+          tc1 += F1[mmax+m]*te; tc2 += F2[mmax+m]*te;
+     }
+}
+
+double FarField::intensity(const Vector &VS, double t, double ph) const {
+     Complex tc1, tc2;
+     field(VS, N, t, ph, tc1, tc2);
+     return norm(tc1) + norm(tc2);
+}
+
+double FarField::max_intensity(const Vector &VS, int Nph, double &th_max, double &ph_max) const {
+     int it, ip, m, ib = 0, mmax = std::min(max_order(VS,N), Mmax);
+     double tv, tm = -1., ta, tb, t1, t2, f1, f2;
+     const double gr = 0.5*(sqrt(5.)-1.);
+     std::vector<Complex> F1(2*mmax+1), F2(2*mmax+1), te(Nph*(2*mmax+1));
+     Complex tc1, tc2;
+     for (ip=0; ip<Nph; ++ip) for (m=-mmax; m<mmax+1; ++m)
+          te[ip*(2*mmax+1)+mmax+m] = exp(j_*(2.*M_PI*m*ip/Nph));
+     th_max = ph_max = 0.;
+     for (it=0; it<Nth; ++it) {
+          amplitudes(VS, it, mmax, F1.data(), F2.data());
+          for (ip=0; ip<Nph; ++ip) {
+               tc1 = tc2 = 0.;
+               for (m=0; m<2*mmax+1; ++m) {tc1 += F1[m]*te[ip*(2*mmax+1)+m]; tc2 += F2[m]*te[ip*(2*mmax+1)+m];}
+               tv = norm(tc1) + norm(tc2);
+               if (tv > tm) {tm = tv; ib = it; th_max = th[it]; ph_max = 2.*M_PI*ip/Nph;}
+          }
+     }
+     if (Nth < 3) return tm;
+          // golden section search between the neighbours of the best node
+     ta = std::min(th[std::max(ib-1,0)], th[std::min(ib+1,Nth-1)]);
+     tb = std::max(th[std::max(ib-1,0)], th[std::min(ib+1,Nth-1)]);
+     t1 = tb - gr*(tb-ta); f1 = intensity(VS, t1, ph_max);
+     t2 = ta + gr*(tb-ta); f2 = intensity(VS, t2, ph_max);
+     for (it=0; it<30; ++it) {
+          if (f1 > f2) {tb = t2; t2 = t1; f2 = f1; t1 = tb - gr*(tb-ta); f1 = intensity(VS, t1, ph_max);}
+          else {ta = t1; t1 = t2; f1 = f2; t2 = ta + gr*(tb-ta); f2 = intensity(VS, t2, ph_max);}
+     }
+     if (f1 > tm) {tm = f1; th_max = t1;}
+     if (f2 > tm) {tm = f2; th_max = t2;}
+     return tm;
+}
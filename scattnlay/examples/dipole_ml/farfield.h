@@ -0,0 +1,60 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef _FARFIELD_H
+#define _FARFIELD_H
+
+#include "matrix.h"
+
+#include <memory>
+#include <vector>
+
+     // Far field of a multipole expansion (same normalization as SphereML::directivity)
+     // on a fixed set of polar angles. Legendre tables are built once per grid, so an
+     // expansion is integrated or searched in O(Nth*N*mmax) operations. The azimuthal
+     // integral is done analytically: |F|^2 integrated over ph equals 2pi sum_m |F_m|^2.
+class FarField {
+public:
+     int N, Nth, Mmax;
+     std::vector<double> th, wt; // polar nodes; Gauss-Legendre weights in cos(th) (empty for sampling grids)
+     std::vector<double> tp, tt; // pi_nm and tau_nm for m=0..Mmax, index ((it*(Mmax+1)+m)*N + n)
+
+          // quadrature == true: Gauss-Legendre nodes in cos(th) over [th1,th2]
+          // quadrature == false: Nth uniformly spaced nodes including both ends
+     FarField(int N_, double th1, double th2, int Nth_, int Mmax_, bool quadrature);
+
+          // shared read-only grids, built on first request
+     static std::shared_ptr<const FarField> cached(int N, double th1, double th2, int Nth, int Mmax, bool quadrature);
+     static int max_order(const Vector &VS, int N);
+          // far-field components F1, F2 in an arbitrary direction (no table needed)
+     static void field(const Vector &VS, int N, double th, double ph, Complex &F1, Complex &F2);
+
+          // azimuthal harmonics F1_m, F2_m (m=-mmax..mmax stored at m+mmax) at node it
+     void amplitudes(const Vector &VS, int it, int mmax, Complex *F1, Complex *F2) const;
+          // |F|^2 integrated over the grid band (quadrature grids only)
+     double power(const Vector &VS) const;
+          // the same with the weight cos(th), e.g. for the asymmetry parameter
+     double power_cos(const Vector &VS) const;
+          // maximum of |F|^2 over the nodes and Nph azimuths, refined in th around the best node
+     double max_intensity(const Vector &VS, int Nph, double &th_max, double &ph_max) const;
+          // |F|^2 in an arbitrary direction
+     double intensity(const Vector &VS, double th, double ph) const;
+};
+
+#endif
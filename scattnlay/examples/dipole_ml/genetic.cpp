@@ -0,0 +1,269 @@
+///
+/// @file   genetic.cpp
+/// @brief  (1+1) evolution strategy and genetic algorithm.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./genetic.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+namespace jade {
+  namespace {
+    /// @brief Step factors of the 1/5th success rule, a success rate of
+    /// 1/5 keeps the step.
+    const double kStepUp = 1.5;
+    const double kStepDown = std::pow(kStepUp, -0.25);
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief get_mutate_func() of algorithms/genetic.py: every
+    /// coordinate gets a normal deviate of standard deviation
+    /// step*range/6/sqrt(dimension) and is clipped to the bounds.
+    void Mutate(const std::vector<double> &lbound,
+                const std::vector<double> &ubound, double step,
+                RandomStream *stream, const double *parent, double *child) {
+      const long n = lbound.size();                                    // NOLINT
+      const double scale = step/6./std::sqrt(static_cast<double>(n));
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        const double value = stream->randn(
+            parent[i], (ubound[i] - lbound[i])*scale);
+        child[i] = std::min(std::max(value, lbound[i]), ubound[i]);
+      }
+    }  // end of void Mutate()
+  }  // end of namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SimulatedBinaryCrossover(const std::vector<double> &lbound,
+                                const std::vector<double> &ubound,
+                                double eta, RandomStream *stream,
+                                double *x1, double *x2) {
+    const double power = 1./(eta + 1.);
+    const long n = lbound.size();                                      // NOLINT
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      if (stream->Uniform() > 0.5) continue;
+      if (std::abs(x1[i] - x2[i]) <= 1e-14) continue;
+      const double y1 = std::min(x1[i], x2[i]), y2 = std::max(x1[i], x2[i]);
+      const double xl = lbound[i], xu = ubound[i];
+      const double rand = stream->Uniform();
+      auto spread = [&](double beta) {
+        const double alpha = 2. - std::pow(beta, -(eta + 1.));
+        return rand <= 1./alpha ? std::pow(rand*alpha, power)
+          : std::pow(1./(2. - rand*alpha), power);
+      };
+      double c1 = 0.5*(y1 + y2 - spread(1. + 2.*(y1 - xl)/(y2 - y1))
+                       *(y2 - y1));
+      double c2 = 0.5*(y1 + y2 + spread(1. + 2.*(xu - y2)/(y2 - y1))
+                       *(y2 - y1));
+      c1 = std::min(std::max(c1, xl), xu);
+      c2 = std::min(std::max(c2, xl), xu);
+      if (stream->Uniform() <= 0.5) std::swap(c1, c2);
+      x1[i] = c1;
+      x2[i] = c2;
+    }  // end of for each coordinate
+  }  // end of void SimulatedBinaryCrossover()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int OnePlusOne::SetMaxPlatoTime(long generations) {                  // NOLINT
+    if (generations < 1)
+      throw std::invalid_argument("Plato time should be at least 1!");
+    max_plato_time_ = generations;
+    return kDone;
+  }  // end of int OnePlusOne::SetMaxPlatoTime(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int OnePlusOne::SetChains(long chains) {                             // NOLINT
+    if (chains < 1)
+      throw std::invalid_argument("Number of chains should be at least 1!");
+    chains_ = chains;
+    return kDone;
+  }  // end of int OnePlusOne::SetChains(long chains)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int OnePlusOne::SetGenerations(long generations) {                   // NOLINT
+    if (generations < 0)
+      throw std::invalid_argument("Number of generations should be >= 0!");
+    generations_limit_ = generations;
+    return kDone;
+  }  // end of int OnePlusOne::SetGenerations(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int OnePlusOne::RunOptimization() {
+    if (evaluation_budget_ == 0 && generations_limit_ == 0)
+      throw std::invalid_argument(
+          "Set an evaluation budget or a number of generations!");
+    StartRun();
+    restarts_ = 0;
+    const long n = dimension_, k = chains_;                            // NOLINT
+    const double max_step = 6.*std::sqrt(static_cast<double>(n));
+    std::vector<double> parent(k*n), parent_cost(k), x(k*n), cost(k);
+    std::vector<double> step(k, 1.);
+    // A fresh chain has no parent yet, its first applicant is a random
+    // point accepted unconditionally.
+    std::vector<long> plato(k, 0);                                     // NOLINT
+    std::vector<char> is_fresh(k, 1);
+    while ((generations_limit_ == 0 || generations_ < generations_limit_)
+           && IsBudgetLeft(k)) {
+      for (long c = 0; c < k; ++c) {                                   // NOLINT
+        double *xc = &x[c*n];
+        if (is_fresh[c]) {
+          for (long i = 0; i < n; ++i)                                 // NOLINT
+            xc[i] = stream_.rand(lbound_[i], ubound_[i]);
+        } else {
+          Mutate(lbound_, ubound_, step[c], &stream_, &parent[c*n], xc);
+        }
+      }
+      EvaluateBatch(x, &cost);
+      for (long c = 0; c < k; ++c) {                                   // NOLINT
+        if (is_fresh[c] || cost[c] < parent_cost[c]) {
+          std::copy(&x[c*n], &x[c*n] + n, &parent[c*n]);
+          parent_cost[c] = cost[c];
+          if (!is_fresh[c]) step[c] = std::min(step[c]*kStepUp, max_step);
+          is_fresh[c] = 0;
+          plato[c] = 0;
+          continue;
+        }
+        step[c] *= kStepDown;
+        if (++plato[c] < max_plato_time_) continue;
+        // Stagnated, restart the chain.
+        is_fresh[c] = 1;
+        step[c] = 1.;
+        plato[c] = 0;
+        ++restarts_;
+      }  // end of for each chain
+      ++generations_;
+    }  // end of generations
+    if (is_verbose_)
+      printf("(1+1)-ES: best %g after %li evaluations, %li restarts\n",
+             is_find_minimum_ ? best_cost_ : -best_cost_, evaluations_,
+             restarts_);
+    return kDone;
+  }  // end of int OnePlusOne::RunOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Genetic::SetPopulation(long popsize) {                           // NOLINT
+    if (popsize < 2)
+      throw std::invalid_argument("Population should be at least 2!");
+    popsize_ = popsize;
+    return kDone;
+  }  // end of int Genetic::SetPopulation(long popsize)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Genetic::SetGenerations(long generations) {                      // NOLINT
+    if (generations < 1)
+      throw std::invalid_argument("Number of generations should be at least 1!");
+    generations_limit_ = generations;
+    return kDone;
+  }  // end of int Genetic::SetGenerations(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Genetic::SetFractions(double elitepercent, double crossoveredpercent) {
+    if (elitepercent < 0 || crossoveredpercent < 0
+        || elitepercent + crossoveredpercent > 1.)
+      throw std::invalid_argument(
+          "Elite and crossovered shares should be >= 0 with sum <= 1!");
+    elitepercent_ = elitepercent;
+    crossoveredpercent_ = crossoveredpercent;
+    return kDone;
+  }  // end of int Genetic::SetFractions()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Genetic::SetEta(double eta) {
+    if (!(eta >= 0)) throw std::invalid_argument("Eta should be >= 0!");
+    eta_ = eta;
+    return kDone;
+  }  // end of int Genetic::SetEta(double eta)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Genetic::RunOptimization() {
+    StartRun();
+    const long n = dimension_, size = popsize_;                        // NOLINT
+    const long elite = static_cast<long>(size*elitepercent_);          // NOLINT
+    long crossovered = static_cast<long>(size*crossoveredpercent_);    // NOLINT
+    crossovered -= crossovered & 1;  // make it even
+    const long mutated = size - elite - crossovered;                   // NOLINT
+    std::vector<double> pop(size*n), next(size*n), cost(size), next_cost(size);
+    std::vector<char> is_valid(size, 0), next_valid(size, 0);
+    for (long p = 0; p < size; ++p)                                    // NOLINT
+      for (long i = 0; i < n; ++i)                                     // NOLINT
+        pop[p*n + i] = stream_.rand(lbound_[i], ubound_[i]);
+    std::vector<double> batch, batch_cost;
+    std::vector<long> invalid, ranked(size), pool(size);               // NOLINT
+    for (long gen = 0; gen < generations_limit_; ++gen) {              // NOLINT
+      // Evaluate the new individuals as one batch.
+      invalid.clear();
+      for (long p = 0; p < size; ++p) if (!is_valid[p]) invalid.push_back(p);  // NOLINT
+      if (!IsBudgetLeft(invalid.size())) break;
+      batch.resize(invalid.size()*n);
+      for (unsigned long b = 0; b < invalid.size(); ++b)               // NOLINT
+        std::copy(&pop[invalid[b]*n], &pop[invalid[b]*n] + n, &batch[b*n]);
+      if (!invalid.empty()) EvaluateBatch(batch, &batch_cost);
+      for (unsigned long b = 0; b < invalid.size(); ++b) {             // NOLINT
+        cost[invalid[b]] = batch_cost[b];
+        is_valid[invalid[b]] = 1;
+      }
+      ++generations_;
+      if (gen + 1 == generations_limit_) break;
+      // Elite.
+      std::iota(ranked.begin(), ranked.end(), 0);
+      std::stable_sort(ranked.begin(), ranked.end(),
+                       [&](long a, long b) {return cost[a] < cost[b];});  // NOLINT
+      long q = 0;                                                      // NOLINT
+      for (; q < elite; ++q) {
+        std::copy(&pop[ranked[q]*n], &pop[ranked[q]*n] + n, &next[q*n]);
+        next_cost[q] = cost[ranked[q]];
+        next_valid[q] = 1;
+      }
+      // Tournaments of two with replacement, then pairwise crossover.
+      for (long c = 0; c < crossovered; ++c, ++q) {                    // NOLINT
+        const long a = stream_.randint(0, size - 1);                   // NOLINT
+        const long b = stream_.randint(0, size - 1);                   // NOLINT
+        const long winner = cost[b] < cost[a] ? b : a;                 // NOLINT
+        std::copy(&pop[winner*n], &pop[winner*n] + n, &next[q*n]);
+        next_valid[q] = 0;
+        if (c & 1)
+          SimulatedBinaryCrossover(lbound_, ubound_, eta_, &stream_,
+                                   &next[(q - 1)*n], &next[q*n]);
+      }
+      // Mutated copies of distinct random members.
+      std::iota(pool.begin(), pool.end(), 0);
+      for (long m = 0; m < mutated; ++m, ++q) {                        // NOLINT
+        std::swap(pool[m], pool[stream_.randint(m, size - 1)]);
+        Mutate(lbound_, ubound_, 1., &stream_, &pop[pool[m]*n], &next[q*n]);
+        next_valid[q] = 0;
+      }
+      pop.swap(next);
+      cost.swap(next_cost);
+      is_valid.swap(next_valid);
+    }  // end of generations
+    if (is_verbose_)
+      printf("GA: best %g after %li evaluations, %li generations\n",
+             is_find_minimum_ ? best_cost_ : -best_cost_, evaluations_,
+             generations_);
+    return kDone;
+  }  // end of int Genetic::RunOptimization()
+}  // end of namespace jade
@@ -0,0 +1,83 @@
+#ifndef SRC_GENETIC_H_
+#define SRC_GENETIC_H_
+///
+/// @file   genetic.h
+/// @brief  (1+1) evolution strategy and genetic algorithm of
+/// algorithms/genetic.py (DEAP) with the same parameters, the
+/// population of a generation is evaluated as one batch.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <vector>
+#include "./optimizer.h"
+namespace jade {
+  /// @brief cxSimulatedBinaryBounded of DEAP: x1 and x2 are mated in
+  /// place, each coordinate with probability 1/2.
+  void SimulatedBinaryCrossover(const std::vector<double> &lbound,
+                                const std::vector<double> &ubound,
+                                double eta, RandomStream *stream,
+                                double *x1, double *x2);
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief (1+1)-ES of one_plus_one(): Gaussian mutation of all
+  /// coordinates with the step range/6/sqrt(dimension) scaled by the
+  /// 1/5th success rule (x1.5 on success, x1.5^(-1/4) on failure),
+  /// clipped to the bounds. A chain restarts from a random point after
+  /// max_plato_time generations in a row without improvement.
+  class OnePlusOne : public Optimizer {
+   public:
+    /// @brief 100 by default, as in algorithms/genetic.py.
+    int SetMaxPlatoTime(long generations);                             // NOLINT
+    /// @brief Independent chains advanced together, each generation
+    /// evaluates one applicant per chain as a batch (1 by default).
+    int SetChains(long chains);                                        // NOLINT
+    /// @brief Stop after `generations`, 0 (default) - run until the
+    /// evaluation budget is spent.
+    int SetGenerations(long generations);                              // NOLINT
+    int RunOptimization() override;
+    long GetRestarts() {return restarts_;}                             // NOLINT
+
+   private:
+    long max_plato_time_ = 100, chains_ = 1, generations_limit_ = 0;   // NOLINT
+    long restarts_ = 0;                                                // NOLINT
+  };  // end of class OnePlusOne
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Generational GA of genetic(): each generation keeps the
+  /// elite, mates pairs picked by tournaments of two with bounded
+  /// simulated binary crossover (DEAP cxSimulatedBinaryBounded) and
+  /// fills the rest with mutated copies of random members. Only the
+  /// new individuals are evaluated.
+  class Genetic : public Optimizer {
+   public:
+    /// @brief 20 by default.
+    int SetPopulation(long popsize);                                   // NOLINT
+    /// @brief Evaluated generations, 300 by default.
+    int SetGenerations(long generations);                              // NOLINT
+    /// @brief Shares of the elite (.1) and of the crossovered (.4,
+    /// rounded down to an even size) individuals.
+    int SetFractions(double elitepercent, double crossoveredpercent);
+    /// @brief Crowding degree of the crossover (sbbx_eta), 1 by default.
+    int SetEta(double eta);
+    int RunOptimization() override;
+
+   private:
+    long popsize_ = 20, generations_limit_ = 300;                      // NOLINT
+    double elitepercent_ = .1, crossoveredpercent_ = .4, eta_ = 1.;
+  };  // end of class Genetic
+}  // end of namespace jade
+#endif  // SRC_GENETIC_H_
@@ -30,82 +30,144 @@
 /// 7003, pp. 34–41, 2011
 #include "./jade.h"
 #include <mpi.h>
+#include <unistd.h>
 #include <random>
 #include <cstdio>
 #include <cmath>
 #include <algorithm>
 #include <map>
 #include <iterator>
+#include <limits>
 #include <string>
 #include <vector>
+#include "./lbfgs.h"
 
 namespace jade {
   /// @todo Replace all simple kError returns with something meangfull. TODO change kError to throw exception
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::Selection(std::vector<double> crossover_u, long i)  {
-    bool is_evaluated = false;
-    double f_current = 0.0;
-    for (auto f : evaluated_fitness_for_current_vectors_) {
-      if (f.second == i) {
-        f_current = f.first;
-        is_evaluated = true;
-      }
-    }  // end of searching of pre-evaluated fitness for current individual
-    if (!is_evaluated) error_status_ = kError;
-    double f_best = evaluated_fitness_for_current_vectors_.front().first;
-    double f_crossover_u = FitnessFunction(crossover_u);
+  /// @name Checkpoint serialization, raw values in native byte order.
+  // @{
+  const char kCheckpointMagic[8] = {'J', 'A', 'D', 'E', 'C', 'K', 'P', '4'};
+  template <class T>
+  void Put(const T *data, std::size_t n, std::vector<char> *state) {
+    const char *bytes = reinterpret_cast<const char*>(data);
+    state->insert(state->end(), bytes, bytes + n*sizeof(T));
+  }
+  template <class T>
+  void Put(const T &value, std::vector<char> *state) {Put(&value, 1, state);}
+  template <class T>
+  void Put(const std::vector<T> &values, std::vector<char> *state) {
+    Put(values.size(), state);
+    Put(values.data(), values.size(), state);
+  }
+  template <class T>
+  void Get(const std::vector<char> &state, std::size_t *position,
+           T *data, std::size_t n) {
+    if (*position + n*sizeof(T) > state.size())
+      throw std::runtime_error("Checkpoint is truncated!");
+    std::copy(&state[*position], &state[*position] + n*sizeof(T),
+              reinterpret_cast<char*>(data));
+    *position += n*sizeof(T);
+  }
+  template <class T>
+  void Get(const std::vector<char> &state, std::size_t *position, T *value) {
+    Get(state, position, value, 1);
+  }
+  template <class T>
+  void Get(const std::vector<char> &state, std::size_t *position,
+           std::vector<T> *values) {
+    std::size_t size = 0;
+    Get(state, position, &size);
+    if (size > state.size()) throw std::runtime_error("Bad checkpoint!");
+    values->resize(size);
+    Get(state, position, values->data(), size);
+  }
+  // @}
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Selection(long i)  {
+    const double f_current = fitness_current_[i];
+    const double f_best = fitness_current_[ranked_current_.front()];
+    const double *crossover_u = Row(trial_vectors_u_, i);
+    const double f_crossover_u = trial_fitness_[i];
     bool is_success = f_crossover_u > f_current
         || f_crossover_u == f_best;  //Selected for maxima search
     if (is_find_minimum_) is_success = !is_success;
     if (!is_success) {
       // Case of current x and f were new for current generation.
-      x_vectors_next_generation_[i] = x_vectors_current_[i];
-      for (auto &f : evaluated_fitness_for_next_generation_) {
-        if (f.second == i) f.first = f_current;
-      }  // end of saving old fitness value in new generation.
+      std::copy(Row(x_vectors_current_, i), Row(x_vectors_current_, i + 1),
+                Row(x_vectors_next_generation_, i));
+      fitness_next_[i] = f_current;
     } else {  // if is_success == true
-      x_vectors_next_generation_[i] = crossover_u;
-      for (auto &f : evaluated_fitness_for_next_generation_) 
-        if (f.second == i) f.first = f_crossover_u;
-      to_be_archived_best_A_.push_back(x_vectors_current_[i]);
+      std::copy(crossover_u, crossover_u + dimension_,
+                Row(x_vectors_next_generation_, i));
+      fitness_next_[i] = f_crossover_u;
+      // Trial vectors of the generation are already built, so the
+      // parent can go to the archive right away.
+      ArchiveParent(i);
       successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
       successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
+      successful_improvement_.push_back(std::abs(f_current - f_crossover_u));
       // if (process_rank_ == kOutput)
       //   printf("n%li f_new=%4.2f\n",i,f_crossover_u);
       //PrintSingleVector(crossover_u);
     }  // end of dealing with success crossover
     return kDone;
-  } // end of int SubPopulation::Selection(std::vector<double> crossover_u);
+  } // end of int SubPopulation::Selection(long i);
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::ArchiveCleanUp() {
-    auto archived_last=archived_best_A_.end();
-    archived_best_A_.splice(archived_last, to_be_archived_best_A_);
-    auto size_A = archived_best_A_.size();
-    long initial_diff = size_A - subpopulation_;
-    // if (process_rank_ == kOutput)
-    //   printf("diff = %li size_A=%li subpop=%li \n ", initial_diff, size_A, subpopulation_);
-    // if (initial_diff < 1) return kDone;
-    // if (process_rank_ == kOutput)
-    //   printf("diff = %li size_A=%li \n ", initial_diff, size_A);
-    for (long i = 0; i < initial_diff; ++i) {
-      long index_to_remove = randint(0, size_A - 1);
-      auto element_A = archived_best_A_.begin();
-      std::advance(element_A, index_to_remove);
-      archived_best_A_.erase(element_A);
-      --size_A;
+  int SubPopulation::ArchiveParent(long i) {                            // NOLINT
+    // The archive keeps at most subpopulation_ vectors. Replacing a
+    // random slot of the full archive (or dropping the new vector) is
+    // the same as appending it and removing a random element.
+    unsigned long slot = archive_size_;
+    if (archive_size_ == subpopulation_) {
+      slot = randint(0, subpopulation_);
+      if (slot == subpopulation_) return kDone;
+    } else {
+      ++archive_size_;
     }
-    const unsigned long new_size_A = archived_best_A_.size();
-    if (new_size_A > subpopulation_) error_status_ = kError; //TODO change kError to throw exception
+    std::copy(Row(x_vectors_current_, i), Row(x_vectors_current_, i + 1),
+              Row(archived_best_A_, slot));
     return kDone;
-  } // end of int SubPopulation:: ArchiveCleanUp();
+  } // end of int SubPopulation::ArchiveParent(long i);
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::Adaption()  {    
+    if (!memory_F_.empty()) {
+      // SHADE, means weighted by fitness improvements.
+      const std::vector<double> &S_F = successful_mutation_parameters_S_F_;
+      const std::vector<double> &S_CR = successful_crossover_parameters_S_CR_;
+      if (S_F.empty()) return kDone;
+      double sum_w = 0;
+      for (auto w : successful_improvement_) sum_w += w;
+      double sum_F = 0, sum_F2 = 0, mean_CR = 0, mean_CR2 = 0, max_CR = 0;
+      for (unsigned long k = 0; k < S_F.size(); ++k) {
+        const double w = sum_w > 0 ? successful_improvement_[k]/sum_w
+          : 1./static_cast<double>(S_F.size());
+        sum_F += w*S_F[k];
+        sum_F2 += w*S_F[k]*S_F[k];
+        mean_CR += w*S_CR[k];
+        mean_CR2 += w*S_CR[k]*S_CR[k];
+        max_CR = std::max(max_CR, S_CR[k]);
+      }
+      memory_F_[memory_position_] = sum_F2/sum_F;
+      // PMCRADE patch, power mean for the scattered S_CR.
+      const double PMCRADE_const = 0.07;
+      if (isPMCRADE_
+          && std::sqrt(std::max(0., mean_CR2 - mean_CR*mean_CR)) >= PMCRADE_const)
+        mean_CR = std::sqrt(mean_CR2);
+      // L-SHADE terminal value, CR = 0 from now on.
+      if (memory_CR_[memory_position_] < 0 || max_CR == 0) mean_CR = -1;
+      memory_CR_[memory_position_] = mean_CR;
+      memory_position_ = (memory_position_ + 1) % memory_F_.size();
+      return kDone;
+    }  // end of SHADE adaption
     long elements = 0;
     double sum = 0.0;
     for (auto CR : successful_crossover_parameters_S_CR_) {
@@ -162,87 +224,607 @@ namespace jade {
     if (error_status_) return error_status_;
     adaptor_mutation_mu_F_ = 0.5;
     adaptor_crossover_mu_CR_ = 0.5;
-    archived_best_A_.clear();
-    CreateInitialPopulation();
+    archive_size_ = 0;
+    current_generation_ = 0;
+    evaluations_ = 0;
+    restarts_ = 0;
+    restart_population_ = total_population_;
+    restart_evaluations_ = 0;
+    is_finished_ = false;
+    ++run_;
+    std::fill(memory_F_.begin(), memory_F_.end(), 0.5);
+    std::fill(memory_CR_.begin(), memory_CR_.end(), 0.5);
+    memory_position_ = 0;
+    screened_trials_ = 0;
+    if (surrogate_capacity_ > 0)
+      surrogate_.Init(dimension_, surrogate_capacity_, x_lbound_, x_ubound_);
+    if (subpopulation_ != static_cast<unsigned long>(total_population_))
+      ResizePopulation(total_population_);
+    next_target_ = 0;
+    trials_made_ = 0;
+    evaluated_in_generation_ = 0;
+    successful_mutation_parameters_S_F_.clear();
+    successful_crossover_parameters_S_CR_.clear();
+    successful_improvement_.clear();
+    if (!LoadCheckpoint()) {
+      // Later generations are checked by CheckTermination().
+      if (evaluation_budget_ > 0
+          && evaluation_budget_ < static_cast<long>(subpopulation_))      // NOLINT
+        throw std::invalid_argument(
+            "Evaluation budget is smaller than the population!");
+      CreateInitialPopulation();
+      EvaluateCurrentVectors();
+      if (IsAsynchronous()) ShareCoordinatorPopulation();
+      if (distribution_level_ == 1) {
+        // Shared seed of random topologies.
+        unsigned long seed = stream_.Next64();                         // NOLINT
+        MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG, 0, communicator_);
+        topology_stream_ = RandomStream(seed, kTopologyDomain, 0, 0);
+      }
+      generations_without_improvement_ = 0;
+      stall_best_fitness_ = fitness_current_[ranked_current_.front()];
+    }  // end of new population
     x_vectors_next_generation_ = x_vectors_current_;
-    EvaluateCurrentVectors();
-    evaluated_fitness_for_next_generation_ =
-      evaluated_fitness_for_current_vectors_;
-    for (long g = 0; g < total_generations_max_; ++g) {
-      if (process_rank_ == kOutput && g%100 == 0) printf("%li\n",g);      
-      to_be_archived_best_A_.clear();
+    fitness_next_ = fitness_current_;
+    long generations = total_generations_max_;                         // NOLINT
+    if (evaluation_budget_ > 0 && generations == 0)
+      generations = std::numeric_limits<long>::max();                  // NOLINT
+    if (ContinueOptimization(generations - current_generation_))
+      return error_status_;
+    if (is_verbose_) {
+      PrintPopulation();
+      PrintEvaluated();
+    }
+    return kDone;
+  }  // end of int SubPopulation::RunOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ContinueOptimization(long generations) {
+    if (error_status_) return error_status_;
+    if (current_generation_ < 0)
+      throw std::invalid_argument("Run optimization before continuing it!");
+    if (is_finished_) return kDone;
+    if (IsAsynchronous()) return SteadyStateGenerations(generations);
+    for (long g = 0; g < generations; ++g) {
+      if (is_verbose_ && process_rank_ == kOutput
+          && current_generation_%100 == 0)
+        printf("%li\n",current_generation_);
       successful_mutation_parameters_S_F_.clear();
       successful_crossover_parameters_S_CR_.clear();        
+      successful_improvement_.clear();
       // //debug section
       // if (process_rank_ == kOutput)
       //   printf("==============  Generation %li =============\n", g);
       // PrintPopulation();      
       // PrintEvaluated();
       //end of debug section
-      for (unsigned long i = 0; i < subpopulation_; ++i) {
-        SetCRiFi(i);
-        std::vector<double> mutated_v, crossover_u;
-        mutated_v = Mutation(i);
-        crossover_u = Crossover(mutated_v, i);
-        Selection(crossover_u, i);
-      }  // end of for all individuals in subpopulation
-      ArchiveCleanUp();
+      // Trial vectors depend only on the current generation, so all of
+      // them are generated first, each from its own random stream, and
+      // evaluated as a batch.
+#pragma omp parallel for if (is_parallel_evaluation_)
+      for (long i = 0; i < static_cast<long>(subpopulation_); ++i)      // NOLINT
+        MakeTrial(i, current_generation_);
+      EvaluateTrials();
+      for (unsigned long i = 0; i < subpopulation_; ++i) Selection(i);
       Adaption();
       x_vectors_current_.swap(x_vectors_next_generation_);
-      evaluated_fitness_for_current_vectors_
-        .swap(evaluated_fitness_for_next_generation_);
+      fitness_current_.swap(fitness_next_);
       SortEvaluatedCurrent();
+      ReducePopulation();
+      if (distribution_level_ == 1) Migrate();
       if (error_status_) return error_status_;
+      ++current_generation_;
+      if (polish_interval_ > 0 && current_generation_ % polish_interval_ == 0)
+        Polish();
+      const bool is_stop = CheckTermination();
+      if (checkpoint_interval_ > 0
+          && current_generation_ % checkpoint_interval_ == 0)
+        SaveCheckpoint();
+      if (is_stop) break;
     }  // end of stepping generations
-    PrintPopulation();      
-    PrintEvaluated();
+    CompleteMigration();
+    if (is_finished_ && (polish_interval_ == 0
+                         || current_generation_ % polish_interval_ != 0))
+      Polish();
     return kDone;
-  }  // end of int SubPopulation::RunOptimization()
+  }  // end of int SubPopulation::ContinueOptimization(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Migrate() {
+    CompleteMigration();
+    if (number_of_processes_ > 1
+        && (current_generation_ + 1) % migration_interval_ == 0)
+      PostMigration();
+    return kDone;
+  }  // end of int SubPopulation::Migrate()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::PostMigration() {
+    const int kMigrationTag = 1;
+    const long row = dimension_ + 1, size = migrants_*row;             // NOLINT
+    SortEvaluatedCurrent(migrants_);
+    for (long m = 0; m < migrants_; ++m) {                             // NOLINT
+      const long n = ranked_current_[m];                               // NOLINT
+      migrants_send_[m*row] = fitness_current_[n];
+      std::copy(Row(x_vectors_current_, n), Row(x_vectors_current_, n + 1),
+                &migrants_send_[m*row + 1]);
+    }
+    std::vector<int> targets, sources;
+    if (topology_ == kRing) {
+      targets.push_back((process_rank_ + 1) % number_of_processes_);
+      sources.push_back((process_rank_ + number_of_processes_ - 1)
+                        % number_of_processes_);
+    } else if (topology_ == kRandom) {
+      // The same shift is drawn on all islands, so each island has
+      // exactly one source.
+      const int shift = topology_stream_.randint(1, number_of_processes_ - 1);
+      targets.push_back((process_rank_ + shift) % number_of_processes_);
+      sources.push_back((process_rank_ + number_of_processes_ - shift)
+                        % number_of_processes_);
+    } else {
+      for (int r = 0; r < number_of_processes_; ++r) {
+        if (r == process_rank_) continue;
+        targets.push_back(r);
+        sources.push_back(r);
+      }
+    }  // end of topology
+    migration_sources_ = sources.size();
+    migrants_recieve_.resize(migration_sources_*size);
+    migration_requests_.resize(targets.size() + sources.size());
+    long i = 0;                                                        // NOLINT
+    for (unsigned long s = 0; s < sources.size(); ++s)
+      MPI_Irecv(&migrants_recieve_[s*size], size, MPI_DOUBLE, sources[s],
+                kMigrationTag, communicator_, &migration_requests_[i++]);
+    for (auto t : targets)
+      MPI_Isend(&migrants_send_.front(), size, MPI_DOUBLE, t,
+                kMigrationTag, communicator_, &migration_requests_[i++]);
+    is_migration_pending_ = true;
+    return kDone;
+  }  // end of int SubPopulation::PostMigration()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::CompleteMigration() {
+    if (!is_migration_pending_) return kDone;
+    if (!migration_requests_.empty())
+      MPI_Waitall(migration_requests_.size(), &migration_requests_.front(),
+                  MPI_STATUSES_IGNORE);
+    migration_requests_.clear();
+    is_migration_pending_ = false;
+    const long row = dimension_ + 1;                                   // NOLINT
+    // Best immigrants first.
+    std::vector<long> immigrants(migration_sources_*migrants_);        // NOLINT
+    for (unsigned long m = 0; m < immigrants.size(); ++m) immigrants[m] = m;
+    const bool is_min = is_find_minimum_;
+    std::sort(immigrants.begin(), immigrants.end(), [&](long a, long b) {  // NOLINT
+        const double fa = migrants_recieve_[a*row];
+        const double fb = migrants_recieve_[b*row];
+        if (fa != fb) return is_min ? fa < fb : fa > fb;
+        return a < b;
+      });
+    immigrants.resize(migrants_);
+    SortEvaluatedCurrent(subpopulation_);
+    for (long m = 0; m < migrants_; ++m) {                             // NOLINT
+      const double *migrant = &migrants_recieve_[immigrants[m]*row];
+      long place = subpopulation_ - 1 - m;                             // NOLINT
+      if (replacement_ == kReplaceRandom) place = randint(1, subpopulation_ - 1);
+      const long n = ranked_current_[place];                           // NOLINT
+      const bool is_better = is_min ? migrant[0] < fitness_current_[n]
+        : migrant[0] > fitness_current_[n];
+      if (!is_better) continue;
+      fitness_current_[n] = migrant[0];
+      std::copy(migrant + 1, migrant + row, Row(x_vectors_current_, n));
+    }  // end of replacement
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::CompleteMigration()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::Crossover(std::vector<double> mutation_v, long i) {
+  int SubPopulation::SteadyStateGenerations(long generations) {       // NOLINT
+    if (evaluation_budget_ > 0) {
+      // Only the coordinator counts evaluations.
+      long left = generations;                                         // NOLINT
+      if (process_rank_ == kOutput)
+        left = std::min(generations, std::max(0L, (evaluation_budget_ - evaluations_)
+                                              /static_cast<long>(subpopulation_)));  // NOLINT
+      MPI_Bcast(&left, 1, MPI_LONG, kOutput, communicator_);
+      is_finished_ = left < generations;
+      generations = left;
+    }
+    // All evaluations are collected at checkpoints, so the coordinator
+    // and the workers split the generations in the same chunks.
+    std::vector<long> chunks;                                          // NOLINT
+    for (long g = current_generation_, end = g + generations; g < end;) {  // NOLINT
+      long step = end - g;                                             // NOLINT
+      if (checkpoint_interval_ > 0)
+        step = std::min(step, checkpoint_interval_
+                        - g % checkpoint_interval_);
+      chunks.push_back(step);
+      g += step;
+    }
+    if (process_rank_ != kOutput) {
+      for (unsigned long c = 0; c < chunks.size(); ++c) WorkerLoop();
+      current_generation_ += generations;
+      ShareCoordinatorPopulation();
+      return error_status_;
+    }
+    // Each individual has at most one trial vector in evaluation, it
+    // is made from the population at the moment of dispatch.
+    std::vector<char> in_flight(subpopulation_, 0);
+    auto next = [&](double *work) {
+      while (in_flight[next_target_])
+        next_target_ = (next_target_ + 1) % subpopulation_;
+      const long i = next_target_;                                     // NOLINT
+      next_target_ = (next_target_ + 1) % subpopulation_;
+      in_flight[i] = 1;
+      MakeTrial(i, trials_made_++);
+      work[0] = i;
+      std::copy(Row(trial_vectors_u_, i), Row(trial_vectors_u_, i + 1),
+                work + 1);
+    };
+    auto done = [&](long i, double f_crossover_u) {                    // NOLINT
+      in_flight[i] = 0;
+      ++evaluations_;
+      SteadyStateSelection(i, f_crossover_u);
+      // mu_F and mu_CR are adapted after every subpopulation_ results.
+      if (++evaluated_in_generation_ < static_cast<long>(subpopulation_))  // NOLINT
+        return;
+      evaluated_in_generation_ = 0;
+      Adaption();
+      successful_mutation_parameters_S_F_.clear();
+      successful_crossover_parameters_S_CR_.clear();
+      successful_improvement_.clear();
+      ++current_generation_;
+      if (is_verbose_ && current_generation_%100 == 0)
+        printf("%li\n",current_generation_);
+    };
+    for (auto step : chunks) {
+      Dispatch(step*subpopulation_, subpopulation_, next, done);
+      if (checkpoint_interval_ > 0
+          && current_generation_ % checkpoint_interval_ == 0)
+        SaveCheckpoint();
+    }
+    ShareCoordinatorPopulation();
+    return error_status_;
+  }  // end of int SubPopulation::SteadyStateGenerations(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SteadyStateSelection(long i, double f_crossover_u) {  // NOLINT
+    const double f_current = fitness_current_[i];
+    const double f_best = fitness_current_[ranked_current_.front()];
+    bool is_success = f_crossover_u > f_current
+        || f_crossover_u == f_best;  //Selected for maxima search
+    if (is_find_minimum_) is_success = !is_success;
+    if (!is_success) return kDone;
+    ArchiveParent(i);
+    std::copy(Row(trial_vectors_u_, i), Row(trial_vectors_u_, i + 1),
+              Row(x_vectors_current_, i));
+    fitness_current_[i] = f_crossover_u;
+    successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
+    successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
+    successful_improvement_.push_back(std::abs(f_current - f_crossover_u));
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::SteadyStateSelection()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Dispatch(long evaluations, long max_in_flight,   // NOLINT
+                              const std::function<void(double *work)> &next,
+                              const std::function<void(long i, double f)> &done) { // NOLINT
+    const long row = dimension_ + 1;                                   // NOLINT
+    std::vector<double> work(row);
+    long sent = 0, received = 0;                                       // NOLINT
+    // Rank kOutput coordinates, all other ranks evaluate.
+    for (int w = 0; w < number_of_processes_; ++w) {
+      if (w == kOutput) continue;
+      if (sent == evaluations || sent == max_in_flight) break;
+      next(&work.front());
+      MPI_Send(&work.front(), row, MPI_DOUBLE, w, kWorkTag, communicator_);
+      ++sent;
+    }
+    while (received < sent) {
+      double result[2];
+      MPI_Status status;
+      MPI_Recv(result, 2, MPI_DOUBLE, MPI_ANY_SOURCE, kResultTag,
+               communicator_, &status);
+      ++received;
+      done(static_cast<long>(result[0]), result[1]);                   // NOLINT
+      if (sent == evaluations) continue;
+      next(&work.front());
+      MPI_Send(&work.front(), row, MPI_DOUBLE, status.MPI_SOURCE, kWorkTag,
+               communicator_);
+      ++sent;
+    }  // end of collecting results
+    for (int w = 0; w < number_of_processes_; ++w)
+      if (w != kOutput)
+        MPI_Send(&work.front(), 0, MPI_DOUBLE, w, kStopTag, communicator_);
+    for (int w = 0; w < number_of_processes_; ++w) {
+      if (w == kOutput) continue;
+      double times[2];
+      MPI_Recv(times, 2, MPI_DOUBLE, w, kReportTag, communicator_,
+               MPI_STATUS_IGNORE);
+      worker_busy_time_ += times[0];
+      worker_total_time_ += times[1];
+    }
+    evaluations_dispatched_ += evaluations;
+    return kDone;
+  }  // end of int SubPopulation::Dispatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::WorkerLoop() {
+    const long row = dimension_ + 1;                                   // NOLINT
+    std::vector<double> work(row);
+    const double start = MPI_Wtime();
+    double busy = 0;
+    while (true) {
+      MPI_Status status;
+      MPI_Recv(&work.front(), row, MPI_DOUBLE, kOutput, MPI_ANY_TAG,
+               communicator_, &status);
+      if (status.MPI_TAG == kStopTag) break;
+      const double begin = MPI_Wtime();
+      double result[2] = {work[0], 0.};
+      if (FitnessFunction)
+        result[1] = FitnessFunction(&work[1], dimension_);
+      else
+        BatchFitnessFunction(&work[1], 1, dimension_, &result[1]);
+      busy += MPI_Wtime() - begin;
+      MPI_Send(result, 2, MPI_DOUBLE, kOutput, kResultTag, communicator_);
+    }  // end of serving the coordinator
+    double times[2] = {busy, MPI_Wtime() - start};
+    MPI_Send(times, 2, MPI_DOUBLE, kOutput, kReportTag, communicator_);
+    return kDone;
+  }  // end of int SubPopulation::WorkerLoop()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ShareCoordinatorPopulation() {
+    MPI_Bcast(&x_vectors_current_.front(), x_vectors_current_.size(),
+              MPI_DOUBLE, kOutput, communicator_);
+    MPI_Bcast(&fitness_current_.front(), fitness_current_.size(),
+              MPI_DOUBLE, kOutput, communicator_);
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::ShareCoordinatorPopulation()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::string SubPopulation::CheckpointFile() {
+    if (number_of_processes_ == 1) return checkpoint_file_;
+    return checkpoint_file_ + "." + std::to_string(process_rank_);
+  }  // end of std::string SubPopulation::CheckpointFile()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SaveCheckpoint() {
+    if (checkpoint_file_.empty()) return kDone;
+    // Workers have no state of their own.
+    if (IsAsynchronous() && process_rank_ != kOutput) return kDone;
+    // Migrants in transit are received now and placed later as usual.
+    if (!migration_requests_.empty()) {
+      MPI_Waitall(migration_requests_.size(), &migration_requests_.front(),
+                  MPI_STATUSES_IGNORE);
+      migration_requests_.clear();
+    }
+    std::vector<char> state;
+    Put(kCheckpointMagic, sizeof(kCheckpointMagic), &state);
+    Put(dimension_, &state);
+    Put(total_population_, &state);
+    Put(subpopulation_, &state);
+    Put(evaluations_, &state);
+    Put(seed_, &state);
+    Put(run_, &state);
+    Put(stream_, &state);
+    Put(topology_stream_, &state);
+    Put(trials_made_, &state);
+    Put(current_generation_, &state);
+    Put(next_target_, &state);
+    Put(evaluated_in_generation_, &state);
+    Put(adaptor_mutation_mu_F_, &state);
+    Put(adaptor_crossover_mu_CR_, &state);
+    Put(x_vectors_current_, &state);
+    Put(fitness_current_, &state);
+    Put(ranked_current_, &state);
+    Put(archive_size_, &state);
+    Put(archived_best_A_.data(), archive_size_*dimension_, &state);
+    Put(successful_mutation_parameters_S_F_, &state);
+    Put(successful_crossover_parameters_S_CR_, &state);
+    Put(successful_improvement_, &state);
+    Put(memory_F_, &state);
+    Put(memory_CR_, &state);
+    Put(memory_position_, &state);
+    Put(restarts_, &state);
+    Put(restart_population_, &state);
+    Put(restart_evaluations_, &state);
+    Put(generations_without_improvement_, &state);
+    Put(stall_best_fitness_, &state);
+    Put(best_ever_fitness_, &state);
+    Put(best_ever_x_, &state);
+    Put(is_finished_, &state);
+    Put(is_migration_pending_, &state);
+    Put(migration_sources_, &state);
+    Put(migrants_recieve_, &state);
+    Put(screened_trials_, &state);
+    Put(surrogate_.GetState(), &state);
+    // Write a temporary file and rename it, so a crash at any moment
+    // leaves a complete checkpoint.
+    const std::string file = CheckpointFile(), temporary = file + ".tmp";
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (!out) throw std::runtime_error("Cannot write " + temporary);
+    bool is_written = fwrite(state.data(), 1, state.size(), out) == state.size()
+      && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    is_written = fclose(out) == 0 && is_written;
+    if (!is_written || std::rename(temporary.c_str(), file.c_str()) != 0)
+      throw std::runtime_error("Cannot write checkpoint " + file);
+    return kDone;
+  }  // end of int SubPopulation::SaveCheckpoint()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool SubPopulation::LoadCheckpoint() {
+    if (checkpoint_file_.empty()) return false;
+    std::vector<char> state;
+    int is_found = 0;
+    if (!IsAsynchronous() || process_rank_ == kOutput) {
+      FILE *in = fopen(CheckpointFile().c_str(), "rb");
+      if (in) {
+        char buffer[1 << 16];
+        std::size_t n = 0;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+          state.insert(state.end(), buffer, buffer + n);
+        fclose(in);
+        is_found = 1;
+      }
+    }
+    // A run is resumed only if every process has its checkpoint.
+    if (distribution_level_ == 1)
+      MPI_Allreduce(MPI_IN_PLACE, &is_found, 1, MPI_INT, MPI_MIN,
+                    communicator_);
+    if (IsAsynchronous())
+      MPI_Bcast(&is_found, 1, MPI_INT, kOutput, communicator_);
+    if (!is_found) return false;
+    if (!IsAsynchronous() || process_rank_ == kOutput) {
+      std::size_t position = 0;
+      char magic[sizeof(kCheckpointMagic)];
+      unsigned long dimension = 0, subpopulation = 0;                  // NOLINT
+      long total_population = 0;                                       // NOLINT
+      Get(state, &position, magic, sizeof(magic));
+      Get(state, &position, &dimension);
+      Get(state, &position, &total_population);
+      Get(state, &position, &subpopulation);
+      if (!std::equal(magic, magic + sizeof(magic), kCheckpointMagic)
+          || dimension != dimension_ || total_population != total_population_)
+        throw std::invalid_argument("Checkpoint " + CheckpointFile()
+                                    + " is of other optimization task!");
+      ResizePopulation(subpopulation);
+      if (archived_best_A_.size() < subpopulation_*dimension_)
+        archived_best_A_.resize(subpopulation_*dimension_);
+      Get(state, &position, &evaluations_);
+      Get(state, &position, &seed_);
+      Get(state, &position, &run_);
+      Get(state, &position, &stream_);
+      Get(state, &position, &topology_stream_);
+      Get(state, &position, &trials_made_);
+      Get(state, &position, &current_generation_);
+      Get(state, &position, &next_target_);
+      Get(state, &position, &evaluated_in_generation_);
+      Get(state, &position, &adaptor_mutation_mu_F_);
+      Get(state, &position, &adaptor_crossover_mu_CR_);
+      Get(state, &position, &x_vectors_current_);
+      Get(state, &position, &fitness_current_);
+      Get(state, &position, &ranked_current_);
+      Get(state, &position, &archive_size_);
+      if (x_vectors_current_.size() != subpopulation_*dimension_
+          || fitness_current_.size() != subpopulation_
+          || ranked_current_.size() != subpopulation_
+          || archive_size_ > subpopulation_)
+        throw std::runtime_error("Bad checkpoint " + CheckpointFile());
+      Get(state, &position, archived_best_A_.data(), archive_size_*dimension_);
+      Get(state, &position, &successful_mutation_parameters_S_F_);
+      Get(state, &position, &successful_crossover_parameters_S_CR_);
+      Get(state, &position, &successful_improvement_);
+      Get(state, &position, &memory_F_);
+      Get(state, &position, &memory_CR_);
+      Get(state, &position, &memory_position_);
+      Get(state, &position, &restarts_);
+      Get(state, &position, &restart_population_);
+      Get(state, &position, &restart_evaluations_);
+      Get(state, &position, &generations_without_improvement_);
+      Get(state, &position, &stall_best_fitness_);
+      Get(state, &position, &best_ever_fitness_);
+      Get(state, &position, &best_ever_x_);
+      Get(state, &position, &is_finished_);
+      Get(state, &position, &is_migration_pending_);
+      Get(state, &position, &migration_sources_);
+      Get(state, &position, &migrants_recieve_);
+      Get(state, &position, &screened_trials_);
+      std::vector<double> model;
+      Get(state, &position, &model);
+      if (surrogate_capacity_ > 0) surrogate_.SetState(model);
+    }  // end of reading state
+    if (IsAsynchronous()) {
+      MPI_Bcast(&current_generation_, 1, MPI_LONG, kOutput, communicator_);
+      ShareCoordinatorPopulation();
+    }
+    if (is_verbose_ && process_rank_ == kOutput)
+      printf("Resumed from %s at generation %li\n",
+             CheckpointFile().c_str(), current_generation_);
+    return true;
+  }  // end of bool SubPopulation::LoadCheckpoint()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double SubPopulation::PrintUtilization() {
+    const double utilization = worker_total_time_ > 0 ?
+      worker_busy_time_/worker_total_time_ : 0.;
+    if (process_rank_ == kOutput && IsAsynchronous()) {
+      printf("# workers %i, evaluations %li, utilization %5.1f %% "
+             "(%g s busy of %g s)\n", number_of_processes_ - 1,
+             evaluations_dispatched_, utilization*100., worker_busy_time_,
+             worker_total_time_);
+      fflush(stdout);
+    }
+    return utilization;
+  }  // end of double SubPopulation::PrintUtilization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SubPopulation::MakeTrial(long i, uint32_t block,               // NOLINT
+                                uint32_t candidate) {
+    RandomStream random(seed_, kTrialDomain + run_, block,
+                        candidate*subpopulation_ + i);
+    double *trial = Row(trial_vectors_u_, i);
+    SetCRiFi(i, &random);
+    Mutation(i, &random, trial);
+    Crossover(i, &random, trial);
+  }  // end of void SubPopulation::MakeTrial()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SubPopulation::Crossover(long i, RandomStream *random,
+                                double *mutation_v) {
     const double CR_i = crossover_CR_[i];
-    std::vector<double> crossover_u, x_current;
-    crossover_u.resize(dimension_);
-    x_current = x_vectors_current_.at(i);
-    unsigned long j_rand = randint(0, dimension_ - 1);
+    const double *x_current = Row(x_vectors_current_, i);
+    unsigned long j_rand = random->randint(0, dimension_ - 1);
     for (unsigned long c = 0; c < dimension_; ++c) {
-      if (c == j_rand || rand(0,1) < CR_i)
-        crossover_u[c] = mutation_v[c];
-      else
-        crossover_u[c] = x_current[c];
+      if (c != j_rand && random->Uniform() >= CR_i)
+        mutation_v[c] = x_current[c];
     }
     // //debug section
     // if (process_rank_ == kOutput)
     //   printf("x -> v -> u with CR_i=%4.2f j_rand=%li\n", CR_i, j_rand);
     // PrintSingleVector(mutation_v);
     // PrintSingleVector(x_current);
-    // PrintSingleVector(crossover_u);
+    // PrintSingleVector(mutation_v);
     // //end of debug section
-    return crossover_u;
-  } // end of  std::vector<double> SubPopulation::Crossover();
+  } // end of  void SubPopulation::Crossover();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::Mutation(long i) {
-    std::vector<double> mutation_v, x_best_current, x_random_current,
-      x_random_archive_and_current, x_current;    
-    x_current = x_vectors_current_.at(i);
-    x_best_current = GetXpBestCurrent();
+  void SubPopulation::Mutation(long i, RandomStream *random,
+                               double *mutation_v) {
+    const double *x_current = Row(x_vectors_current_, i);
+    const double *x_best_current = GetXpBestCurrent(random);
     // //debug
     // if (process_rank_ == kOutput) printf("x_best: ");
     // PrintSingleVector(x_best_current);
     long index_of_random_current = -1;
-    x_random_current = GetXRandomCurrent(&index_of_random_current, i);
+    const double *x_random_current =
+      GetXRandomCurrent(random, &index_of_random_current, i);
     // //debug
     // if (process_rank_ == kOutput) printf("x_random: ");
     // PrintSingleVector(x_random_current);    
-    x_random_archive_and_current = GetXRandomArchiveAndCurrent(index_of_random_current, i);
+    const double *x_random_archive_and_current =
+      GetXRandomArchiveAndCurrent(random, index_of_random_current, i);
     // //debug
     // if (process_rank_ == kOutput) printf("x_random with archive: ");
     // PrintSingleVector(x_random_archive_and_current);
-    mutation_v.resize(dimension_);
     double F_i = mutation_F_[i];
     for (unsigned long c = 0; c < dimension_; ++c) {
       // Mutation
@@ -275,66 +857,54 @@ namespace jade {
     //   printf("  -> f = %4.2f                                    F_i=%4.2f\n",
     //          FitnessFunction(mutation_v), F_i);
     // //end of debug section
-    return mutation_v;
-  } // end of std::vector<double> SubPopulation::Mutation();
+  } // end of void SubPopulation::Mutation();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXpBestCurrent() {
+  const double *SubPopulation::GetXpBestCurrent(RandomStream *random) {
     const unsigned long n_best_total = static_cast<long>
       (floor(subpopulation_ * best_share_p_ ));
     if (n_best_total == subpopulation_) error_status_ = kError; //TODO change kError to throw exception
-    long best_n = randint(0, n_best_total);
-    long best_n_index = -1, i = 0;
-    for (auto x : evaluated_fitness_for_current_vectors_) {
-      if (i == best_n) {
-        best_n_index = x.second;
-        break;
-      }
-      ++i;
-    }
-    return x_vectors_current_.at(best_n_index);
-  }  // end of std::vector<double> SubPopulation::GetXpBestCurrent();
+    long best_n = random->randint(0, n_best_total);
+    return Row(x_vectors_current_, ranked_current_[best_n]);
+  }  // end of const double *SubPopulation::GetXpBestCurrent();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXRandomCurrent(long *index, long forbidden_index) {
-    long random_n = randint(0, subpopulation_-1);
-    while (random_n == forbidden_index) random_n = randint(0, subpopulation_-1);
+  const double *SubPopulation::GetXRandomCurrent(RandomStream *random,
+                                                 long *index, long forbidden_index) {
+    long random_n = random->randint(0, subpopulation_-1);
+    while (random_n == forbidden_index)
+      random_n = random->randint(0, subpopulation_-1);
     (*index) = random_n;
-    return x_vectors_current_.at(random_n);
-  }  // end of std::vector<double> SubPopulation::GetXRandomCurrent()
+    return Row(x_vectors_current_, random_n);
+  }  // end of const double *SubPopulation::GetXRandomCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXRandomArchiveAndCurrent
-  (unsigned long forbidden_index1, unsigned long forbidden_index2) {
-    long archive_size = archived_best_A_.size();
-    unsigned long random_n = randint(0, subpopulation_ + archive_size - 1);
+  const double *SubPopulation::GetXRandomArchiveAndCurrent
+  (RandomStream *random, unsigned long forbidden_index1,
+   unsigned long forbidden_index2) {
+    unsigned long random_n =
+      random->randint(0, subpopulation_ + archive_size_ - 1);
     while (random_n == forbidden_index1 || random_n == forbidden_index2)
-      random_n = randint(0, subpopulation_ + archive_size - 1);
-    if (random_n < subpopulation_) return x_vectors_current_.at(random_n);
-    random_n -= subpopulation_;
-    unsigned long i = 0;
-    for (auto x : archived_best_A_) {
-      if (i == random_n) {
-        // //debug
-        // if (process_rank_ == kOutput) printf("Using Archive!!\n");
-        return x;
-      }
-      ++i;
-    }  // end of selecting from archive
-    error_status_ = kError; //TODO change kError to throw exception
-    std::vector<double> x;
-    return x;    
-  }  // end of std::vector<double> SubPopulation::GetXRandomArchiveAndCurrent()
+      random_n = random->randint(0, subpopulation_ + archive_size_ - 1);
+    if (random_n < subpopulation_) return Row(x_vectors_current_, random_n);
+    return Row(archived_best_A_, random_n - subpopulation_);
+  }  // end of const double *SubPopulation::GetXRandomArchiveAndCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::SetCRiFi(long i) {
+  int SubPopulation::SetCRiFi(long i, RandomStream *random) {
+    double mu_F = adaptor_mutation_mu_F_, mu_CR = adaptor_crossover_mu_CR_;
+    if (!memory_F_.empty()) {
+      const long r = random->randint(0, memory_F_.size() - 1);         // NOLINT
+      mu_F = memory_F_[r];
+      mu_CR = memory_CR_[r];
+    }
     long k = 0;
     while (1) {
-      mutation_F_[i] = randc(adaptor_mutation_mu_F_, 0.1);
+      mutation_F_[i] = random->randc(mu_F, 0.1);
       if (mutation_F_[i] > 1) {
         mutation_F_[i] = 1;
         break;
@@ -347,11 +917,11 @@ namespace jade {
       }
       if (k > 100) printf("k");
     }
-    crossover_CR_[i] = randn(adaptor_crossover_mu_CR_,0.1);
+    crossover_CR_[i] = mu_CR < 0 ? 0 : random->randn(mu_CR,0.1);
     if (crossover_CR_[i] > 1) crossover_CR_[i] = 1;
     if (crossover_CR_[i] < 0) crossover_CR_[i] = 0;    
     return kDone;
-  }  // end of int SubPopulation::SetCRiFi(long i)
+  }  // end of int SubPopulation::SetCRiFi(long i, RandomStream *random)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
@@ -363,53 +933,324 @@ namespace jade {
     dimension_ = dimension;
     if (dimension_ < 1) 
       throw std::invalid_argument("You should set dimension > 0!");
-    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank_);
-    MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes_);
+    MPI_Comm_rank(communicator_, &process_rank_);
+    MPI_Comm_size(communicator_, &number_of_processes_);
     if (process_rank_ < 0)
       throw std::invalid_argument("MPI problem: process_rank_ < 0!");
     if (number_of_processes_ < 1)
       throw std::invalid_argument("MPI problem: number_of_processes_ < 1!");
     std::random_device rd;
-    generator_.seed(rd());
+    SetSeed((static_cast<uint64_t>(rd()) << 32) | rd());
 
     // //debug
     // CheckRandom();
 
     subpopulation_ = total_population;
 
-    current_generation_ = 0;
-    x_vectors_current_.resize(subpopulation_);
-    for (auto &x : x_vectors_current_) x.resize(dimension_);
-    x_vectors_next_generation_.resize(subpopulation_);
-    for (auto &x : x_vectors_next_generation_) x.resize(dimension_);
-    evaluated_fitness_for_current_vectors_.resize(subpopulation_);
+    current_generation_ = -1;
+    ResizePopulation(subpopulation_);
+    migrants_send_.resize(migrants_*(dimension_ + 1));
+    archived_best_A_.resize(subpopulation_*dimension_);
+    archive_size_ = 0;
+    successful_mutation_parameters_S_F_.reserve(subpopulation_);
+    successful_crossover_parameters_S_CR_.reserve(subpopulation_);
+    successful_improvement_.reserve(subpopulation_);
     // //debug
     // if (process_rank_ == kOutput) printf("%i, x1 size = %li \n", process_rank_, x_vectors_current_.size());
     x_lbound_.resize(dimension_);
     x_ubound_.resize(dimension_);
+    return kDone;
+  }  // end of void SubPopulation::Init()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ResizePopulation(unsigned long size) {           // NOLINT
+    subpopulation_ = size;
+    x_vectors_current_.resize(subpopulation_*dimension_);
+    x_vectors_next_generation_.resize(subpopulation_*dimension_);
+    trial_vectors_u_.resize(subpopulation_*dimension_);
+    best_candidates_.resize(subpopulation_*dimension_);
+    trial_fitness_.resize(subpopulation_);
+    fitness_current_.resize(subpopulation_);
+    fitness_next_.resize(subpopulation_);
     mutation_F_.resize(subpopulation_);
     crossover_CR_.resize(subpopulation_);
+    ranked_current_.resize(subpopulation_);
+    for (unsigned long i = 0; i < subpopulation_; ++i) ranked_current_[i] = i;
     return kDone;
-  }  // end of void SubPopulation::Init()
+  }  // end of int SubPopulation::ResizePopulation(unsigned long size)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ReducePopulation() {
+    if (min_population_ == 0) return kDone;
+    // Linear from the start of the run (or of the last restart).
+    const double share = max_evaluations_ <= restart_evaluations_ ? 1.
+      : std::min(1., static_cast<double>(evaluations_ - restart_evaluations_)
+                 /static_cast<double>(max_evaluations_ - restart_evaluations_));
+    long size = std::lround(restart_population_                         // NOLINT
+                            + (min_population_ - restart_population_)*share);
+    size = std::max(size, migrants_ + 1);
+    if (size >= static_cast<long>(subpopulation_)) return kDone;       // NOLINT
+    // Survivors go to the first rows in the order of fitness.
+    SortEvaluatedCurrent(size);
+    for (long n = 0; n < size; ++n) {                                  // NOLINT
+      const long from = ranked_current_[n];                            // NOLINT
+      std::copy(Row(x_vectors_current_, from),
+                Row(x_vectors_current_, from + 1),
+                Row(x_vectors_next_generation_, n));
+      fitness_next_[n] = fitness_current_[from];
+    }
+    x_vectors_current_.swap(x_vectors_next_generation_);
+    fitness_current_.swap(fitness_next_);
+    // The archive keeps at most size vectors, random ones are removed.
+    while (archive_size_ > static_cast<unsigned long>(size)) {        // NOLINT
+      const unsigned long slot = randint(0, archive_size_ - 1);        // NOLINT
+      --archive_size_;
+      std::copy(Row(archived_best_A_, archive_size_),
+                Row(archived_best_A_, archive_size_ + 1),
+                Row(archived_best_A_, slot));
+    }
+    ResizePopulation(size);
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::ReducePopulation()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool SubPopulation::CheckTermination() {
+    const double f_best = fitness_current_[ranked_current_.front()];
+    const bool is_better = is_find_minimum_ ? f_best < stall_best_fitness_
+      : f_best > stall_best_fitness_;
+    if (is_better) {
+      stall_best_fitness_ = f_best;
+      generations_without_improvement_ = 0;
+    } else {
+      ++generations_without_improvement_;
+    }
+    const bool is_collapsed = IsCollapsed();
+    const bool is_restart = is_collapsed && restart_factor_ > 0;
+    const long next = is_restart                                       // NOLINT
+      ? std::lround(restart_population_*restart_factor_) : subpopulation_;
+    int flags[2] = {evaluation_budget_ == 0
+                    || evaluations_ + next <= evaluation_budget_,
+                    is_collapsed && !is_restart};
+    // Islands stop together, when one of them is out of budget or all
+    // of them have collapsed.
+    const bool is_checked = evaluation_budget_ > 0 || stall_generations_ > 0
+      || tolerance_fitness_ > 0 || tolerance_diameter_ > 0;
+    if (distribution_level_ == 1 && number_of_processes_ > 1 && is_checked)
+      MPI_Allreduce(MPI_IN_PLACE, flags, 2, MPI_INT, MPI_MIN, communicator_);
+    if (!flags[0] || flags[1]) {
+      is_finished_ = true;
+      return true;
+    }
+    if (is_restart) Restart();
+    return false;
+  }  // end of bool SubPopulation::CheckTermination()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool SubPopulation::IsCollapsed() {
+    if (stall_generations_ > 0
+        && generations_without_improvement_ >= stall_generations_)
+      return true;
+    if (tolerance_fitness_ > 0) {
+      const auto range = std::minmax_element(fitness_current_.begin(),
+                                             fitness_current_.end());
+      if (*range.second - *range.first <= tolerance_fitness_) return true;
+    }
+    if (tolerance_diameter_ > 0) {
+      double diameter = 0;
+      for (unsigned long c = 0; c < dimension_; ++c) {
+        double low = x_vectors_current_[c], high = low;
+        for (unsigned long i = 1; i < subpopulation_; ++i) {
+          low = std::min(low, Row(x_vectors_current_, i)[c]);
+          high = std::max(high, Row(x_vectors_current_, i)[c]);
+        }
+        diameter = std::max(diameter,
+                            (high - low)/(x_ubound_[c] - x_lbound_[c]));
+      }  // end of for each coordinate
+      if (diameter <= tolerance_diameter_) return true;
+    }
+    return false;
+  }  // end of bool SubPopulation::IsCollapsed()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Restart() {
+    best_ever_x_ = GetBest(&best_ever_fitness_);
+    ++restarts_;
+    restart_population_ = std::lround(restart_population_*restart_factor_);
+    restart_evaluations_ = evaluations_;
+    ResizePopulation(restart_population_);
+    if (archived_best_A_.size() < subpopulation_*dimension_)
+      archived_best_A_.resize(subpopulation_*dimension_);
+    archive_size_ = 0;
+    adaptor_mutation_mu_F_ = 0.5;
+    adaptor_crossover_mu_CR_ = 0.5;
+    std::fill(memory_F_.begin(), memory_F_.end(), 0.5);
+    std::fill(memory_CR_.begin(), memory_CR_.end(), 0.5);
+    memory_position_ = 0;
+    CreateInitialPopulation();
+    EvaluateCurrentVectors();
+    generations_without_improvement_ = 0;
+    stall_best_fitness_ = fitness_current_[ranked_current_.front()];
+    if (is_verbose_ && process_rank_ == kOutput)
+      printf("Restart %li with population %lu after %li evaluations\n",
+             restarts_, subpopulation_, restart_evaluations_);
+    return kDone;
+  }  // end of int SubPopulation::Restart()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Polish() {
+    if (polish_count_ == 0 || IsAsynchronous()) return kDone;
+    const long count = std::min(polish_count_,                         // NOLINT
+                                static_cast<long>(subpopulation_));    // NOLINT
+    SortEvaluatedCurrent(count);
+    const std::vector<long> polished(ranked_current_.begin(),         // NOLINT
+                                     ranked_current_.begin() + count);
+    LBFGS local;
+    local.Init(dimension_);
+    local.FitnessFunction = FitnessFunction;
+    local.BatchFitnessFunction = BatchFitnessFunction;
+    local.SetAllBoundsVectors(x_lbound_, x_ubound_);
+    if (is_find_minimum_) local.SetTargetToMinimum();
+    else local.SetTargetToMaximum();
+    local.SetParallelEvaluation(is_parallel_evaluation_);
+    for (auto i : polished) {
+      // The descent needs at least a gradient after the start point.
+      long budget = polish_evaluations_;                               // NOLINT
+      if (evaluation_budget_ > 0) {
+        const long left = evaluation_budget_ - evaluations_;           // NOLINT
+        budget = budget == 0 ? left : std::min(budget, left);
+        if (budget < 2*static_cast<long>(dimension_) + 2) break;       // NOLINT
+      }
+      local.SetEvaluationBudget(budget);
+      local.SetStart(std::vector<double>(Row(x_vectors_current_, i),
+                                         Row(x_vectors_current_, i + 1)));
+      local.RunOptimization();
+      evaluations_ += local.GetEvaluations();
+      double f = 0;
+      const std::vector<double> x = local.GetBest(&f);
+      const bool is_better = is_find_minimum_ ? f < fitness_current_[i]
+        : f > fitness_current_[i];
+      if (!is_better) continue;
+      std::copy(x.begin(), x.end(), Row(x_vectors_current_, i));
+      fitness_current_[i] = f;
+    }  // end of for each polished individual
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::Polish()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetPolishing(long interval, long count,           // NOLINT
+                                  long evaluations) {                  // NOLINT
+    if (interval < 0 || count < 0 || evaluations < 0)
+      throw std::invalid_argument("Polishing parameters should be >= 0!");
+    polish_interval_ = interval;
+    polish_count_ = count;
+    polish_evaluations_ = evaluations;
+    return kDone;
+  }  // end of int SubPopulation::SetPolishing()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetSurrogate(long capacity, long candidates,     // NOLINT
+                                  double kappa) {
+    if ((capacity != 0 && capacity < 4) || candidates < 1 || !(kappa >= 0))
+      throw std::invalid_argument("Surrogate needs capacity >= 4 (0 - off), "
+                                  "candidates >= 1 and kappa >= 0!");
+    surrogate_capacity_ = capacity;
+    candidates_ = candidates;
+    surrogate_kappa_ = kappa;
+    return kDone;
+  }  // end of int SubPopulation::SetSurrogate()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetEvaluationBudget(long evaluations) {           // NOLINT
+    if (evaluations < 0)
+      throw std::invalid_argument("Evaluation budget should be >= 0!");
+    evaluation_budget_ = evaluations;
+    return kDone;
+  }  // end of int SubPopulation::SetEvaluationBudget(long evaluations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetConvergence(double fitness_spread, double diameter,
+                                    long stall_generations) {          // NOLINT
+    if (fitness_spread < 0 || diameter < 0 || stall_generations < 0)
+      throw std::invalid_argument("Convergence criteria should be >= 0!");
+    tolerance_fitness_ = fitness_spread;
+    tolerance_diameter_ = diameter;
+    stall_generations_ = stall_generations;
+    return kDone;
+  }  // end of int SubPopulation::SetConvergence()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetRestarts(double population_factor) {
+    if (population_factor != 0 && population_factor < 1)
+      throw std::invalid_argument("Restart population factor should be "
+                                  ">= 1 (or 0 for no restarts)!");
+    restart_factor_ = population_factor;
+    return kDone;
+  }  // end of int SubPopulation::SetRestarts(double population_factor)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetHistoryMemory(long size) {                     // NOLINT
+    if (size < 0) throw std::invalid_argument("Memory size should be >= 0!");
+    memory_F_.assign(size, 0.5);
+    memory_CR_.assign(size, 0.5);
+    memory_position_ = 0;
+    return kDone;
+  }  // end of int SubPopulation::SetHistoryMemory(long size)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetPopulationReduction(long min_population,      // NOLINT
+                                            long max_evaluations) {    // NOLINT
+    if (min_population != 0
+        && (min_population < 4 || min_population > total_population_
+            || max_evaluations < 1))
+      throw std::invalid_argument("Population reduction needs 4 <= "
+                                  "min_population <= total_population "
+                                  "and max_evaluations > 0!");
+    min_population_ = min_population;
+    max_evaluations_ = max_evaluations;
+    return kDone;
+  }  // end of int SubPopulation::SetPopulationReduction()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SubPopulation::SetSeed(unsigned long seed) {                     // NOLINT
+    seed_ = seed;
+    run_ = 0;
+    stream_ = RandomStream(seed_, kSequentialDomain, 0, 0);
+  }  // end of void SubPopulation::SetSeed(unsigned long seed)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::PrintPopulation() {
+    SortEvaluatedCurrent(subpopulation_);
     if (process_rank_ == kOutput) {
       printf("\n");	
-      for (auto x : evaluated_fitness_for_current_vectors_) {
-	long n = x.second;
-	double fitness = x.first;
+      for (auto n : ranked_current_) {
+	double fitness = fitness_current_[n];
         printf("%6.2f:% 3li||", fitness, n);
         for (unsigned long c = 0; c < dimension_; ++c) 
-          printf(" %+7.2f ", x_vectors_current_[n][c]);
+          printf(" %+7.2f ", Row(x_vectors_current_, n)[c]);
 	printf("\n");      
       }
 
       // for (long i = 0; i < subpopulation_; ++i) {
       //   printf("n%li:", i);
       //   for (long c = 0; c < dimension_; ++c) {
-      //     printf(" %5.2f ", x_vectors_current_[i][c]);
+      //     printf(" %5.2f ", Row(x_vectors_current_, i)[c]);
       //   }
       //   printf("\n");
       // }  // end of for each individual
@@ -420,9 +1261,10 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::PrintEvaluated() {
+    SortEvaluatedCurrent(subpopulation_);
     if (process_rank_ == kOutput) {
-      for (auto x : evaluated_fitness_for_current_vectors_)
-        printf("%li:%4.2f  ", x.second, x.first);
+      for (auto n : ranked_current_)
+        printf("%li:%4.2f  ", n, fitness_current_[n]);
       printf("\n");
     }  // end of if output
     return kDone;
@@ -458,24 +1300,27 @@ namespace jade {
   int SubPopulation::CreateInitialPopulation() {
     if ((subpopulation_ - x_feed_vectors_.size()) <1)
       throw std::invalid_argument("Too large feed!");
-    x_vectors_current_.resize(subpopulation_ - x_feed_vectors_.size());
-    for (auto &x : x_vectors_current_)
+    const unsigned long n_random = subpopulation_ - x_feed_vectors_.size();
+    for (unsigned long n = 0; n < n_random; ++n) {
+      double *x = Row(x_vectors_current_, n);
       for (unsigned long i = 0; i < dimension_; ++i) {
         if (x_lbound_[i] > x_ubound_[i])
 	  throw std::invalid_argument("Wrong order of bounds!");
         x[i] = rand(x_lbound_[i], x_ubound_[i]);                            // NOLINT
       }  // end of for each dimension
+    }  // end of for each random individual
     // //debug
     // for (auto x : x_vectors_current_[0]) if (process_rank_ == kOutput) printf("%g ",x);
+    unsigned long n_feed = n_random;
     for (auto x: x_feed_vectors_) {
-      x_vectors_current_.push_back(x);
-        if (process_rank_ == kOutput) {
+      std::copy(x.begin(), x.end(), Row(x_vectors_current_, n_feed++));
+        if (is_verbose_ && process_rank_ == kOutput) {
 	  printf("--=-- Feed:\n");
 	  for (auto index:x) printf(" %+7.2f", index);
 	  printf("\n");
 	}	
     }
-    if (x_vectors_current_.size() != subpopulation_)
+    if (n_feed != subpopulation_)
       throw std::invalid_argument("Population is not full after feed!");	
     x_feed_vectors_.clear();
     // if (process_rank_ == kOutput) {
@@ -488,35 +1333,110 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::SortEvaluatedCurrent() {
-    evaluated_fitness_for_current_vectors_
-      .sort([=](const std::pair<double, long>& a,                     // NOLINT
-               const std::pair<double, long>& b) {                   // NOLINT
-              bool cmp = a.first < b.first;
-              if (is_find_minimum_) return cmp;
-              return !cmp;
-            });
+  int SubPopulation::SortEvaluatedCurrent(unsigned long ranks) {       // NOLINT
+    // Only the p-best individuals are ranked in the generation loop;
+    // ties are ordered by index, so the ranking is deterministic.
+    if (ranks == 0)
+      ranks = static_cast<long>(floor(subpopulation_ * best_share_p_)) + 1;
+    if (ranks > subpopulation_) ranks = subpopulation_;
+    const std::vector<double> &f = fitness_current_;
+    const bool is_min = is_find_minimum_;
+    std::partial_sort(ranked_current_.begin(), ranked_current_.begin() + ranks,
+                      ranked_current_.end(), [&](long a, long b) {    // NOLINT
+                        if (f[a] != f[b]) return is_min ? f[a] < f[b] : f[a] > f[b];
+                        return a < b;
+                      });
     return kDone;
   }  // end of int SubPopulation::SortEvaluatedCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::EvaluateCurrentVectors() {
-    evaluated_fitness_for_current_vectors_.clear();
-    for (unsigned long i = 0; i < subpopulation_; ++i) {                        // NOLINT
-      auto tmp = std::make_pair(FitnessFunction(x_vectors_current_[i]), i);
-      evaluated_fitness_for_current_vectors_.push_back(tmp);
-    }
+    EvaluateBatch(x_vectors_current_, &fitness_current_);
+    if (surrogate_capacity_ > 0 && !IsAsynchronous())
+      surrogate_.Add(x_vectors_current_, fitness_current_);
     SortEvaluatedCurrent();
     // //debug
     // if (process_rank_ == kOutput) printf("\n After ");
-    // for (auto val : evaluated_fitness_for_current_vectors_)
-    //   if (process_rank_ == kOutput) printf("%g ", val.first);
+    // for (auto val : fitness_current_)
+    //   if (process_rank_ == kOutput) printf("%g ", val);
     return kDone;
   }  // end of int SubPopulation::EvaluateCurrentVectors()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  int SubPopulation::EvaluateTrials() {
+    if (surrogate_capacity_ > 0 && !IsAsynchronous()) {
+      if (candidates_ > 1 && surrogate_.Size() > static_cast<long>(dimension_)) {  // NOLINT
+        // The trial of each individual is the best predicted of its
+        // candidates, the first candidate is the trial of plain JADE.
+        const double sign = is_find_minimum_ ? 1. : -1.;
+#pragma omp parallel for if (is_parallel_evaluation_)
+        for (long i = 0; i < static_cast<long>(subpopulation_); ++i) {  // NOLINT
+          double *trial = Row(trial_vectors_u_, i);
+          double *best = Row(best_candidates_, i);
+          std::copy(trial, trial + dimension_, best);
+          double best_F = mutation_F_[i], best_CR = crossover_CR_[i];
+          double mean = 0, stddev = 0;
+          surrogate_.Predict(trial, &mean, &stddev);
+          double best_score = sign*mean - surrogate_kappa_*stddev;
+          for (long k = 1; k < candidates_; ++k) {                     // NOLINT
+            MakeTrial(i, current_generation_, k);
+            surrogate_.Predict(trial, &mean, &stddev);
+            const double score = sign*mean - surrogate_kappa_*stddev;
+            if (!(score < best_score)) continue;
+            best_score = score;
+            std::copy(trial, trial + dimension_, best);
+            best_F = mutation_F_[i];
+            best_CR = crossover_CR_[i];
+          }
+          std::copy(best, best + dimension_, trial);
+          mutation_F_[i] = best_F;
+          crossover_CR_[i] = best_CR;
+        }  // end of for each individual
+        screened_trials_ += (candidates_ - 1)*subpopulation_;
+      }
+      EvaluateBatch(trial_vectors_u_, &trial_fitness_);
+      surrogate_.Add(trial_vectors_u_, trial_fitness_);
+      return kDone;
+    }
+    return EvaluateBatch(trial_vectors_u_, &trial_fitness_);
+  }  // end of int SubPopulation::EvaluateTrials()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluateBatch(const std::vector<double> &x,
+                                   std::vector<double> *fitness) {
+    const long size = x.size()/dimension_;                             // NOLINT
+    if (!FitnessFunction && !BatchFitnessFunction)
+      throw std::invalid_argument("You should set fitness function!");
+    evaluations_ += size;
+    if (IsAsynchronous()) {
+      // Results are shared by ShareCoordinatorPopulation().
+      if (process_rank_ != kOutput) return WorkerLoop();
+      long k = 0;                                                      // NOLINT
+      auto next = [&](double *work) {
+        work[0] = k;
+        std::copy(&x[k*dimension_], &x[(k + 1)*dimension_], work + 1);
+        ++k;
+      };
+      auto done = [&](long i, double f) {(*fitness)[i] = f;};         // NOLINT
+      return Dispatch(size, number_of_processes_ - 1, next, done);
+    }
+    if (BatchFitnessFunction) {
+      BatchFitnessFunction(&x.front(), size, dimension_, &fitness->front());
+      return kDone;
+    }
+    // Each result has its own slot, so the outcome does not depend on
+    // the evaluation order.
+#pragma omp parallel for schedule(dynamic) if (is_parallel_evaluation_)
+    for (long i = 0; i < size; ++i)                                    // NOLINT
+      (*fitness)[i] = FitnessFunction(&x[i*dimension_], dimension_);
+    return kDone;
+  }  // end of int SubPopulation::EvaluateBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   void SubPopulation::SetAllBoundsVectors
   (std::vector<double> lbound, std::vector<double> ubound) {
     x_lbound_.clear();
@@ -540,29 +1460,25 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   double SubPopulation::randn(double mean, double stddev) {
-    std::normal_distribution<double> distribution(mean, stddev);
-    return distribution(generator_);
+    return stream_.randn(mean, stddev);
   }  // end of double SubPopulation::randn(double mean, double stddev)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   double SubPopulation::randc(double location, double scale) {
-    std::cauchy_distribution<double> distribution(location, scale);
-    return distribution(generator_);
+    return stream_.randc(location, scale);
   }  // end of double SubPopulation::randc(double location, double scale)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   long SubPopulation::randint(long lbound, long ubound) {    // NOLINT
-    std::uniform_int_distribution<long> distribution(lbound, ubound);  // NOLINT
-    return distribution(generator_);
+    return stream_.randint(lbound, ubound);
   }
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   double SubPopulation::rand(double lbound, double ubound) {                // NOLINT
-    std::uniform_real_distribution<double> distribution(lbound, ubound);
-    return distribution(generator_);
+    return stream_.rand(lbound, ubound);
   }  // end of double rand(double lbound, double ubound)
   // ********************************************************************** //
   // ********************************************************************** //
@@ -629,6 +1545,8 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::SetDistributionLevel(int level) {
+    if (level < 0 || level > 2)
+      throw std::invalid_argument("Distribution level should be 0, 1 or 2!");
     distribution_level_ = level;
     return kDone;
   }
@@ -636,6 +1554,30 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  void SubPopulation::SetCommunicator(MPI_Comm comm) {
+    communicator_ = comm;
+    MPI_Comm_rank(communicator_, &process_rank_);
+    MPI_Comm_size(communicator_, &number_of_processes_);
+  }  // end of void SubPopulation::SetCommunicator(MPI_Comm comm)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetMigration(Topology topology, long interval,   // NOLINT
+                                  long migrants, Replacement replacement) { // NOLINT
+    if (interval < 1)
+      throw std::invalid_argument("Migration interval should be > 0!");
+    if (migrants < 1 || static_cast<unsigned long>(migrants) >= subpopulation_)
+      throw std::invalid_argument("Wrong number of migrants (call after Init)!");
+    topology_ = topology;
+    migration_interval_ = interval;
+    migrants_ = migrants;
+    replacement_ = replacement;
+    migrants_send_.resize(migrants_*(dimension_ + 1));
+    return kDone;
+  }  // end of int SubPopulation::SetMigration()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::PrintParameters(std::string comment) {
     if (process_rank_ == 0) {
       printf("#%s dim=%li NP=%li(of %li) p=%4.2f c=%4.2f generation=%li\n",
@@ -651,8 +1593,7 @@ namespace jade {
   // ********************************************************************** //
   int SubPopulation::PrintResult(std::string comment) {    
     if (distribution_level_ == 0) {      
-      auto x = evaluated_fitness_for_current_vectors_.front();
-      std::vector<double> to_send {x.first};
+      std::vector<double> to_send {fitness_current_[ranked_current_.front()]};
       //printf("%8.5g\n  ", x.first);
       AllGatherVectorDouble(to_send);
       if (process_rank_ == 0) {
@@ -678,8 +1619,7 @@ namespace jade {
   std::vector<double> SubPopulation::GetFinalFitness() {
     recieve_double_.clear();    
     if (distribution_level_ == 0) {      
-      auto x = evaluated_fitness_for_current_vectors_.front();
-      std::vector<double> to_send {x.first};
+      std::vector<double> to_send {fitness_current_[ranked_current_.front()]};
       AllGatherVectorDouble(to_send);      
     }
     return recieve_double_;
@@ -688,17 +1628,53 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   std::vector<double> SubPopulation::GetBest(double *best_fitness) {
-    auto x = evaluated_fitness_for_current_vectors_.front();
-    (*best_fitness) = x.first;
-    return x_vectors_current_[x.second];
+    const long n = ranked_current_.front();                            // NOLINT
+    (*best_fitness) = fitness_current_[n];
+    if (restarts_ > 0 && (is_find_minimum_
+                          ? best_ever_fitness_ < *best_fitness
+                          : best_ever_fitness_ > *best_fitness)) {
+      (*best_fitness) = best_ever_fitness_;
+      return best_ever_x_;
+    }
+    return std::vector<double>(Row(x_vectors_current_, n),
+                               Row(x_vectors_current_, n + 1));
   }  // end of std::vector<double> SubPopulation::GetBest(double *best_fitness)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  std::vector<double> SubPopulation::GetGlobalBest(double *best_fitness) {
+    std::vector<double> best = GetBest(best_fitness);
+    struct {double fitness; int rank;} local {*best_fitness, process_rank_}, global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT,
+                  is_find_minimum_ ? MPI_MINLOC : MPI_MAXLOC, communicator_);
+    MPI_Bcast(&best.front(), dimension_, MPI_DOUBLE, global.rank,
+              communicator_);
+    (*best_fitness) = global.fitness;
+    return best;
+  }  // end of std::vector<double> SubPopulation::GetGlobalBest()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<std::vector<double> > SubPopulation::GetElite(long count) {  // NOLINT
+    count = std::min(count, static_cast<long>(subpopulation_));        // NOLINT
+    SortEvaluatedCurrent(count);
+    std::vector<std::vector<double> > elite;
+    for (long i = 0; i < count; ++i) {                                 // NOLINT
+      const long n = ranked_current_[i];                               // NOLINT
+      elite.emplace_back(Row(x_vectors_current_, n),
+                         Row(x_vectors_current_, n + 1));
+    }
+    return elite;
+  }  // end of std::vector<std::vector<double> > SubPopulation::GetElite()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   std::vector<double> SubPopulation::GetWorst(double *worst_fitness) {
-    auto x = evaluated_fitness_for_current_vectors_.back();
-    (*worst_fitness) = x.first;
-    return x_vectors_current_[x.second];
+    SortEvaluatedCurrent(subpopulation_);
+    const long n = ranked_current_.back();                             // NOLINT
+    (*worst_fitness) = fitness_current_[n];
+    return std::vector<double>(Row(x_vectors_current_, n),
+                               Row(x_vectors_current_, n + 1));
   }  // end of std::vector<double> SubPopulation::GetWorst(double *worst_fitness)
   // ********************************************************************** //
   // ********************************************************************** //
@@ -710,7 +1686,7 @@ namespace jade {
     recieve_double_.resize(size_all);
     MPI_Allgather(&to_send.front(), size_single, MPI_DOUBLE,
                   &recieve_double_.front(), size_single, MPI_DOUBLE,
-                  MPI_COMM_WORLD);
+                  communicator_);
     return kDone;
   }  // end of int SubPopulation::AllGatherVectorDouble(std::vector<double> to_send);
   // ********************************************************************** //
@@ -723,7 +1699,7 @@ namespace jade {
     recieve_long_.resize(size_all);
     MPI_Allgather(&to_send.front(), size_single, MPI_LONG,
                   &recieve_long_.front(), size_single, MPI_LONG,
-                  MPI_COMM_WORLD);
+                  communicator_);
     return kDone;
   }  // end of int SubPopulation::AllGatherVectorLong(std::vector<long> to_send);
   // ********************************************************************** //
@@ -30,28 +30,143 @@
 /// in 'Power Mean Based Crossover Rate Adaptive Differential
 /// Evolution' in H. Deng et al. (Eds.): AICI 2011, Part II, LNAI
 /// 7003, pp. 34–41, 2011
+#include <mpi.h>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <random>
 #include <utility>
-#include <list>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "./surrogate.h"
 namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Island model: where the migrants of each island go.
+  enum Topology {
+    /// to the next rank
+    kRing = 0,
+    /// to a random rank, the same permutation is drawn on all ranks
+    kRandom,
+    /// to all other ranks, the best of all immigrants are kept
+    kFullyConnected
+  };  // end of enum Topology
+  /// @brief Island model: which individuals the immigrants replace.
+  enum Replacement {
+    /// the worst individuals, if the immigrant is better
+    kReplaceWorst = 0,
+    /// random individuals except the best, if the immigrant is better
+    kReplaceRandom
+  };  // end of enum Replacement
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Counter-based random numbers, Philox4x32-10 from John
+  /// K. Salmon et al. 'Parallel random numbers: as easy as 1, 2, 3',
+  /// SC'11. A stream is keyed by (seed, domain, block, item), e.g.
+  /// (seed, trials, generation, individual), and its numbers do not
+  /// depend on any other stream, so streams can be drawn in any order
+  /// by any thread or process with bit-identical results.
+  class RandomStream {
+   public:
+    RandomStream() {}
+    RandomStream(uint64_t seed, uint32_t domain, uint32_t block,
+                 uint32_t item) {
+      key_[0] = static_cast<uint32_t>(seed);
+      key_[1] = static_cast<uint32_t>(seed >> 32);
+      counter_[0] = 0;
+      counter_[1] = item;
+      counter_[2] = block;
+      counter_[3] = domain;
+    }
+    uint32_t Next32() {
+      if (used_ == 4) Generate();
+      return output_[used_++];
+    }
+    uint64_t Next64() {
+      const uint64_t high = Next32();
+      return (high << 32) | Next32();
+    }
+    /// @brief Uniform in [0, 1) with 53 random bits.
+    double Uniform() {return (Next64() >> 11)*(1.0/9007199254740992.0);}
+    double rand(double lbound, double ubound) {
+      return lbound + (ubound - lbound)*Uniform();
+    }
+    long randint(long lbound, long ubound) {                           // NOLINT
+      const long value = lbound + static_cast<long>                    // NOLINT
+        (Uniform()*static_cast<double>(ubound - lbound + 1));
+      return value > ubound ? ubound : value;
+    }
+    /// @brief Box-Muller transform, no state is kept between calls.
+    double randn(double mean, double stddev) {
+      const double u = 1.0 - Uniform(), v = Uniform();
+      return mean + stddev*std::sqrt(-2.0*std::log(u))
+        *std::cos(2.0*M_PI*v);
+    }
+    double randc(double location, double scale) {
+      return location + scale*std::tan(M_PI*(Uniform() - 0.5));
+    }
+
+   private:
+    void Generate() {
+      uint32_t c[4] = {counter_[0], counter_[1], counter_[2], counter_[3]};
+      uint32_t k[2] = {key_[0], key_[1]};
+      for (int round = 0; round < 10; ++round) {
+        const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u)*c[0];
+        const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u)*c[2];
+        const uint32_t c0 = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0];
+        const uint32_t c2 = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1];
+        c[1] = static_cast<uint32_t>(p1);
+        c[3] = static_cast<uint32_t>(p0);
+        c[0] = c0;
+        c[2] = c2;
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+      }  // end of rounds
+      for (int i = 0; i < 4; ++i) output_[i] = c[i];
+      ++counter_[0];
+      used_ = 0;
+    }  // end of void Generate()
+    uint32_t key_[2] = {0, 0}, counter_[4] = {0, 0, 0, 0}, output_[4];
+    int used_ = 4;
+  };  // end of class RandomStream
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   /// @brief Population controlled by single MPI process.
   class SubPopulation {
    public:
-    /// @brief Externaly defined fitness function, used by pointer.
-    double (*FitnessFunction)(std::vector<double> x) = nullptr;
+    /// @brief Externaly defined fitness function of x[0..dimension-1],
+    /// user context goes to the captures of the callable.
+    std::function<double(const double *x, long dimension)>             // NOLINT
+        FitnessFunction;
+    /// @brief Optional fitness of a whole batch of size vectors stored
+    /// row by row in x, used instead of FitnessFunction when set.
+    std::function<void(const double *x, long size, long dimension,     // NOLINT
+                       double *fitness)> BatchFitnessFunction;
     /// @brief Class initialization.
     int Init(long total_population, long dimension);              // NOLINT
+    /// @brief Make the run reproducible (call after Init).
+    void SetSeed(unsigned long seed);                                 // NOLINT
+    /// @brief Build trial vectors and evaluate FitnessFunction for a
+    /// generation in OpenMP threads (default), FitnessFunction should be
+    /// thread safe. Results do not depend on the number of threads.
+    void SetParallelEvaluation(bool is_parallel) {
+      is_parallel_evaluation_ = is_parallel;
+    }
+    /// @brief Print progress and the final population (default).
+    void SetVerbose(bool is_verbose) {is_verbose_ = is_verbose;}
     /// @brief Vizualize used random distributions (to do manual check).
     void SetFeed(std::vector<std::vector<double> > x_feed_vectors);
     void CheckRandom();
     /// @brief Find optimum value of fitness function.
     int RunOptimization();
+    /// @brief Evolve the population of the last RunOptimization() for
+    /// more generations, keeping the archive and adapted parameters.
+    int ContinueOptimization(long generations);                     // NOLINT
+    long GetCurrentGeneration() {return current_generation_;}         // NOLINT
     /// @brief Set maximum number of generations used for optimization.
     void SetTotalGenerationsMax(long gen) {total_generations_max_ = gen;} // NOLINT
     /// @brief Select if to find global minimum or maximum of fitness function.
@@ -60,9 +175,95 @@ namespace jade {
     /// @brief Set adaption parameters.
     int SetBestShareP(double p);
     int SetAdapitonFrequencyC(double c);
+    /// @brief SHADE success-history adaption (Ryoji Tanabe and Alex
+    /// Fukunaga, CEC 2013): mu_F and mu_CR of each individual are taken
+    /// from a random one of `size` memory entries, the entries are
+    /// replaced in turn by the improvement-weighted means of S_F and
+    /// S_CR. Size 0 switches back to JADE adaption.
+    int SetHistoryMemory(long size);                                   // NOLINT
+    /// @brief L-SHADE linear population size reduction (Tanabe and
+    /// Fukunaga, CEC 2014): the population shrinks linearly from
+    /// total_population to min_population over max_evaluations, worst
+    /// individuals are removed. Synchronous modes only (levels 0, 1).
+    int SetPopulationReduction(long min_population,                    // NOLINT
+                               long max_evaluations);                  // NOLINT
+    /// @brief Stop RunOptimization() and ContinueOptimization() before
+    /// this process exceeds `evaluations` fitness evaluations in the
+    /// run, RunOptimization() is then not limited by the generations
+    /// count if it is 0 (default). 0 - no budget. The initial population
+    /// is evaluated as a whole, a smaller budget fails the run.
+    int SetEvaluationBudget(long evaluations);                         // NOLINT
+    /// @brief The population has collapsed if the fitness spread (best
+    /// to worst) is below fitness_spread, or its diameter in coordinates
+    /// normalized by the bounds is below diameter, or the best fitness
+    /// did not improve for stall_generations generations (0 switches a
+    /// criterion off). Synchronous modes only (levels 0, 1).
+    int SetConvergence(double fitness_spread, double diameter,
+                       long stall_generations);                        // NOLINT
+    /// @brief IPOP restarts (Anne Auger and Nikolaus Hansen, CEC 2005):
+    /// a collapsed population is replaced by a new random one
+    /// population_factor times larger, the best-ever individual is kept
+    /// for GetBest(). Factor 0 - the run stops at collapse.
+    int SetRestarts(double population_factor);
+    /// @brief Hybrid search: every `interval` generations and when the
+    /// run is finished, the `count` best individuals are refined by a
+    /// projected L-BFGS descent (lbfgs.h) of up to `evaluations` fitness
+    /// evaluations each (0 - until it converges) within the budget, and
+    /// replaced by the result if it is better. Interval 0 - only when
+    /// finished, count 0 - no polishing. Synchronous modes only (levels
+    /// 0, 1), each island polishes its own individuals.
+    int SetPolishing(long interval, long count, long evaluations);     // NOLINT
+    /// @brief Surrogate-assisted mode: `candidates` trial vectors are
+    /// built for each individual, a Gaussian-process model (surrogate.h)
+    /// of up to `capacity` recently evaluated points pre-screens them
+    /// and only the one with the best optimistic prediction (mean -+
+    /// kappa*stddev) is evaluated. Capacity 0 - off. Synchronous modes
+    /// only (levels 0, 1).
+    int SetSurrogate(long capacity, long candidates, double kappa);   // NOLINT
+    /// @brief Trial vectors screened out by the surrogate without
+    /// evaluation in the last run.
+    long GetScreenedTrials() {return screened_trials_;}                // NOLINT
+    /// @brief Budget is spent or the population has collapsed without
+    /// restarts (the island model stops when all islands have).
+    bool IsFinished() {return is_finished_;}
+    long GetRestarts() {return restarts_;}                             // NOLINT
+    /// @brief Fitness evaluations done by this process in the last run.
+    long GetEvaluations() {return evaluations_;}                        // NOLINT
+    long GetPopulation() {return subpopulation_;}                        // NOLINT
     /// @brief Set level of algorithm distribution.
     /// 0 - no distribution, each MPI process acts independantly.
+    /// 1 - island model, each MPI process of the communicator evolves
+    /// its own population (of total_population individuals) and
+    /// exchanges migrants with other islands. RunOptimization() and
+    /// ContinueOptimization() are then collective over the communicator.
+    /// 2 - asynchronous steady state, rank 0 of the communicator keeps
+    /// the population and hands out trial vectors, other ranks evaluate
+    /// them. A result is selected as soon as it arrives; mu_F and mu_CR
+    /// are adapted after every total_population results (a generation).
     int SetDistributionLevel(int level);
+    /// @brief Group of MPI processes to work together (call after Init).
+    void SetCommunicator(MPI_Comm comm);
+    /// @brief Every interval generations send migrants best individuals.
+    int SetMigration(Topology topology, long interval, long migrants,  // NOLINT
+                     Replacement replacement);
+    /// @brief Best individual over all islands of the communicator.
+    std::vector<double> GetGlobalBest(double *best_fitness);
+    /// @brief Up to `count` best individuals of this process, best
+    /// first, e.g. to warm-start a related run with SetFeed().
+    std::vector<std::vector<double> > GetElite(long count);            // NOLINT
+    /// @brief Save the state every interval generations to file (with
+    /// suffix .<rank> for communicators of several processes), the old
+    /// checkpoint is replaced atomically. If the file exists,
+    /// RunOptimization() resumes from it and reproduces the
+    /// uninterrupted run (call after SetSeed() and the other setup).
+    void SetCheckpoint(std::string file, long interval) {             // NOLINT
+      checkpoint_file_ = file;
+      checkpoint_interval_ = interval;
+    }
+    int SaveCheckpoint();
+    /// @brief Share of worker time spent in fitness evaluations
+    /// (distribution level 2), printed by rank 0.
+    double PrintUtilization();
     /// @brief Set same search bounds for all components of fitness
     /// function input vector.
     int SetAllBounds(double lbound, double ubound);
@@ -76,37 +277,67 @@ namespace jade {
     std::vector<double> GetBest(double *best_fitness);
     std::vector<double> GetWorst(double *worst_fitness);
     int ErrorStatus() {return error_status_;};
+    ~SubPopulation() {CompleteMigration();}
     void SwitchOffPMCRADE(){isPMCRADE_ = false;};
    private:
     bool isPMCRADE_ = true;
     bool isFeed_ = false;
+    bool is_verbose_ = true;
     int CreateInitialPopulation();
     int PrintPopulation();
     int PrintEvaluated();
     int PrintSingleVector(std::vector<double> x);
-    int SortEvaluatedCurrent();
+    /// @brief Rank leading `ranks` individuals (0 - only p-best).
+    int SortEvaluatedCurrent(unsigned long ranks = 0);                 // NOLINT
     /// @brief Apply fitness function to current population.
     int EvaluateCurrentVectors();
+    /// @brief Evaluate the trial vectors (pre-screened by the surrogate).
+    int EvaluateTrials();
+    /// @brief Apply fitness function to a batch of vectors.
+    int EvaluateBatch(const std::vector<double> &x,
+                      std::vector<double> *fitness);
+    /// @brief Row i of a population matrix.
+    double *Row(std::vector<double> &x, long i) {                      // NOLINT
+      return &x[i*dimension_];
+    }
     /// @brief Generate crossover and mutation factors for current individual
-    int SetCRiFi(long i);
+    int SetCRiFi(long i, RandomStream *random);
+    /// @brief Set number of individuals, the state of remaining
+    /// individuals is kept.
+    int ResizePopulation(unsigned long size);                          // NOLINT
+    /// @brief Drop worst individuals according to population reduction.
+    int ReducePopulation();
+    /// @brief Check budget and convergence after a generation, restart
+    /// a collapsed population. Returns true to stop.
+    bool CheckTermination();
+    bool IsCollapsed();
+    int Restart();
+    /// @brief Local search from the best individuals (SetPolishing()).
+    int Polish();
+    /// @brief Trial vector of individual i (in generation or trial
+    /// `block`) from its own random stream, other candidates of the
+    /// surrogate mode have streams of their own.
+    void MakeTrial(long individual_index, uint32_t block,             // NOLINT
+                   uint32_t candidate = 0);
     /// @name Main algorithm steps.
     // @{
-    int Selection(std::vector<double> crossover_u,
-                  long individual_index);
-    int ArchiveCleanUp();
+    int Selection(long individual_index);                              // NOLINT
+    int ArchiveParent(long individual_index);                          // NOLINT
     int Adaption();
-    std::vector<double> Mutation(long individual_index);
-    std::vector<double> Crossover(std::vector<double> mutated_v,
-                                  long individual_index);
+    void Mutation(long individual_index, RandomStream *random,        // NOLINT
+                  double *mutated_v);
+    /// @brief Crossover in place, mutated_v becomes crossover_u.
+    void Crossover(long individual_index, RandomStream *random,       // NOLINT
+                   double *mutated_v);
     // @}
     /// @name Other algorithm steps.
     // @{
-    std::vector<double> GetXpBestCurrent();
+    const double *GetXpBestCurrent(RandomStream *random);
     /// @brief Returns random vector from current population and
     /// vector`s index.
-    std::vector<double> GetXRandomCurrent(long *index,
-                                          long forbidden_index);
-    std::vector<double> GetXRandomArchiveAndCurrent(
+    const double *GetXRandomCurrent(RandomStream *random, long *index, // NOLINT
+                                    long forbidden_index);             // NOLINT
+    const double *GetXRandomArchiveAndCurrent(RandomStream *random,
         unsigned long forbidden_index1, unsigned long forbidden_index2);
     // @}
     /// @name Population, individuals and algorithm .
@@ -129,25 +360,30 @@ namespace jade {
     long current_generation_ = -1;                                     // NOLINT
     /// @brief Several feed vectors.
     std::vector<std::vector<double> > x_feed_vectors_;
-    /// @brief Current state vectors of all individuals in subpopulation.
-    std::vector<std::vector<double> > x_vectors_current_;
+    /// @brief Current state vectors of all individuals in subpopulation
+    /// (subpopulation_ x dimension_ matrix, one row per individual).
+    std::vector<double> x_vectors_current_;
     /// @brief State vectors of all individuals in subpopulation in
     /// new generation.
-    std::vector<std::vector<double> > x_vectors_next_generation_;
-    /// @brief Sometimes sorted list of evaluated fitness function.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_current_vectors_;
-    /// @brief Sometimes sorted list of evaluated fitness function for
-    /// next generation.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_next_generation_;
-    /// @brief Archived best solutions (state vactors)
-    std::list<std::vector<double> > archived_best_A_;
-    std::list<std::vector<double> > to_be_archived_best_A_;
-    /// @brief Sometimes sorted list of evaluated fitness function for
-    /// best vectors.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_archived_best_;
+    std::vector<double> x_vectors_next_generation_;
+    /// @brief Trial vectors of the current generation and their fitness.
+    std::vector<double> trial_vectors_u_;
+    std::vector<double> trial_fitness_;
+    /// @brief Best predicted candidate of each individual in the
+    /// surrogate-assisted mode, same layout as trial_vectors_u_.
+    std::vector<double> best_candidates_;
+    bool is_parallel_evaluation_ = true;
+    /// @brief Fitness of current individuals, indexed as individuals.
+    std::vector<double> fitness_current_;
+    /// @brief Fitness of individuals in new generation.
+    std::vector<double> fitness_next_;
+    /// @brief Individual indices, best first (only leading p-best part
+    /// is kept sorted during the optimization).
+    std::vector<long> ranked_current_;                                 // NOLINT
+    /// @brief Archived parents (state vectors), archive_size_ rows of
+    /// dimension_ values in a flat array of subpopulation_ rows.
+    std::vector<double> archived_best_A_;
+    unsigned long archive_size_ = 0;                                   // NOLINT
     /// @brief Low and upper bounds for x vectors.
     std::vector<double> x_lbound_;
     std::vector<double> x_ubound_;
@@ -157,8 +393,36 @@ namespace jade {
     double adaptor_crossover_mu_CR_ = 0.5;
     /// @brief Individual mutation and crossover parameters for each individual.
     std::vector<double> mutation_F_, crossover_CR_;
-    std::list<double> successful_mutation_parameters_S_F_;
-    std::list<double> successful_crossover_parameters_S_CR_;
+    std::vector<double> successful_mutation_parameters_S_F_;
+    std::vector<double> successful_crossover_parameters_S_CR_;
+    /// @brief Fitness improvements of successful trials (SHADE weights).
+    std::vector<double> successful_improvement_;
+    /// @brief SHADE memory of mu_F and mu_CR, negative mu_CR is the
+    /// L-SHADE terminal value (CR = 0), next entry to replace.
+    std::vector<double> memory_F_, memory_CR_;
+    unsigned long memory_position_ = 0;                                // NOLINT
+    /// @brief Population reduction, no reduction for min_population_ 0.
+    long min_population_ = 0, max_evaluations_ = 0;                    // NOLINT
+    long evaluations_ = 0;                                             // NOLINT
+    /// @name Termination and restarts.
+    // @{
+    long evaluation_budget_ = 0;                                       // NOLINT
+    double tolerance_fitness_ = 0, tolerance_diameter_ = 0;
+    long stall_generations_ = 0, generations_without_improvement_ = 0; // NOLINT
+    double stall_best_fitness_ = 0;
+    double restart_factor_ = 0;
+    long polish_interval_ = 0, polish_count_ = 0, polish_evaluations_ = 0;  // NOLINT
+    Surrogate surrogate_;
+    long surrogate_capacity_ = 0, candidates_ = 1, screened_trials_ = 0;  // NOLINT
+    double surrogate_kappa_ = 0.;
+    long restarts_ = 0;                                                // NOLINT
+    /// @brief Population size and evaluations at the last restart.
+    long restart_population_ = 0, restart_evaluations_ = 0;            // NOLINT
+    /// @brief Best individual of the previous restarts.
+    std::vector<double> best_ever_x_;
+    double best_ever_fitness_ = 0;
+    bool is_finished_ = false;
+    // @}
     /// @brief Share of all individuals in current population to be
     /// the best, recomended value range 0.05-0.2
     //const double best_share_p_ = 0.12;
@@ -175,9 +439,12 @@ namespace jade {
     /// @name Random generation
     /// Names are in notation from Jingqiao Zhang and Arthur C. Sanderson book.
     // @{
-    /// @todo Select random generator enginge for best results in DE!
-    //std::mt19937_64 generator_;
-    std::ranlux48 generator_;
+    /// Trial vectors use RandomStream(seed_, kTrialDomain + run, block,
+    /// individual), other draws come from the sequential stream_.
+    uint64_t seed_ = 0;
+    uint32_t run_ = 0;
+    RandomStream stream_;
+    enum {kSequentialDomain = 0, kTopologyDomain, kTrialDomain};
     /// @brief randn(&mu;, &sigma^2; ) denotes a random value from a normal
     /// distribution of mean &mu; and variance &sigma^2;
     double randn(double mean, double stddev);
@@ -191,8 +458,49 @@ namespace jade {
     // @}
     /// @name MPI section
     // @{
+    MPI_Comm communicator_ = MPI_COMM_WORLD;
     int process_rank_;
     int number_of_processes_;
+    /// @brief Migration is posted with non-blocking sends and receives
+    /// and completed a generation later, so it overlaps with evolution.
+    int Migrate();
+    int PostMigration();
+    int CompleteMigration();
+    Topology topology_ = kRing;
+    Replacement replacement_ = kReplaceWorst;
+    long migration_interval_ = 20, migrants_ = 1;                      // NOLINT
+    /// @brief Random topology permutations, same on all islands.
+    RandomStream topology_stream_;
+    /// @brief Migrants as rows of [fitness, x...].
+    std::vector<double> migrants_send_, migrants_recieve_;
+    std::vector<MPI_Request> migration_requests_;
+    long migration_sources_ = 0;                                       // NOLINT
+    /// @brief Migrants are posted or received, but not yet placed.
+    bool is_migration_pending_ = false;
+    /// @brief Asynchronous coordinator and workers.
+    bool IsAsynchronous() {
+      return distribution_level_ == 2 && number_of_processes_ > 1;
+    }
+    int SteadyStateGenerations(long generations);                      // NOLINT
+    int SteadyStateSelection(long individual_index, double fitness);   // NOLINT
+    /// @brief Send evaluations work rows [index, x...] made by next() to
+    /// the workers (at most max_in_flight at once), done() receives the
+    /// results in order of arrival.
+    int Dispatch(long evaluations, long max_in_flight,                 // NOLINT
+                 const std::function<void(double *work)> &next,
+                 const std::function<void(long i, double f)> &done);   // NOLINT
+    int WorkerLoop();
+    int ShareCoordinatorPopulation();
+    /// @brief Restore the checkpoint if all processes have it.
+    bool LoadCheckpoint();
+    std::string CheckpointFile();
+    std::string checkpoint_file_;
+    long checkpoint_interval_ = 0;                                     // NOLINT
+    enum {kWorkTag = 2, kResultTag, kStopTag, kReportTag};
+    long next_target_ = 0, evaluated_in_generation_ = 0;               // NOLINT
+    uint32_t trials_made_ = 0;
+    long evaluations_dispatched_ = 0;                                  // NOLINT
+    double worker_busy_time_ = 0, worker_total_time_ = 0;
     int AllGatherVectorDouble(std::vector<double> to_send);
     std::vector<double> recieve_double_;
     int AllGatherVectorLong(std::vector<long> to_send);
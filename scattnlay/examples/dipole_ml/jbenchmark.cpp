@@ -0,0 +1,336 @@
+///
+/// @file   jbenchmark.cpp
+/// @brief  Evaluations-to-target benchmark of JADE++ adaption
+/// strategies and of the other engines on f1-f13 of functions.py and
+/// on the directivity of a dipole in a two-layer sphere.
+///
+/// Usage: mpirun -np <n> ./jbenchmark [dimensions [evaluations [runs
+///        [problems [strategies]]]]]
+///   dimensions 30     dimensions of f1-f13, a comma separated list as
+///                     2,10,30,100
+///   evaluations 300000  budget of a run
+///   runs 5            independent runs (seeds 1..runs)
+///   problems all      all, directivity or a comma separated list as
+///                     f1,f5,f9
+///   strategies all    all or a comma separated list of the names below
+///
+/// Strategies:
+///   JADE       population 100, mu_F and mu_CR adaption
+///   SHADE      population 100, success-history memory of 6 entries
+///   JADE-LPSR  population reduced linearly from 18*dimension to 4
+///   L-SHADE    both of them
+///   JADE-LBFGS JADE with an L-BFGS descent from the best individual
+///              every 50 generations
+///   JADE-GP    JADE evaluating the best of 4 trial vectors per
+///              individual predicted by a Gaussian-process model of the
+///              last 200 evaluated points
+///   CMA-ES     BIPOP restarts, default population
+///   1+1-ES     (1+1)-ES with the 1/5th success rule
+///   GA         genetic algorithm of algorithms/genetic.py, population 20
+/// PMCRADE crossover adaption is used by all JADE strategies. Test
+/// functions are evaluated by their vectorized batch versions, a
+/// generation at a time.
+///
+/// A run stops when the budget is spent or (JADE strategies) the target
+/// is reached. The target of f1-f13 is the global minimum + 1e-8
+/// (+ dimension/2 for the noise of f7); the directivity target is 99% of the best directivity
+/// found by any run. Runs are distributed round-robin over MPI
+/// processes, rank 0 prints for each problem and strategy the number
+/// of successful runs, the median evaluations to target over them and
+/// the mean best fitness (minus directivity) at the end of the runs.
+#include <mpi.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "./cmaes.h"
+#include "./directivity.h"
+#include "./genetic.h"
+#include "./jade.h"
+#include "./testfunctions.h"
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+enum Engine {kJADE, kCMAES, kOnePlusOne, kGenetic};
+struct Strategy {
+  const char *name;
+  Engine engine;
+  /// @brief Initial population is population + per_dimension*dimension.
+  long population, per_dimension, min_population, memory;  // NOLINT
+  /// @brief Generations between L-BFGS polishing of the best, 0 - none.
+  long polish;  // NOLINT
+  /// @brief Points of the surrogate model, 0 - none.
+  long surrogate;  // NOLINT
+};
+struct Problem {
+  std::string name;
+  std::function<double(const double *x, long dimension)> function;  // NOLINT
+  /// @brief Optional batch version of function.
+  std::function<void(const double *x, long size, long dimension,  // NOLINT
+                     double *fitness)> batch;
+  std::vector<double> lbound, ubound;
+  /// @brief Runs stop at this value (all runs go to the budget if it
+  /// is -inf), the reported target may be set after the runs.
+  double stop, target;
+};
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Directivity of optimize.py as minimization problem,
+/// x = [Rd, R1, R2, n1, n2] with max_ratio 0.6, on the canonical design
+/// as in joptimize.
+Problem DirectivityProblem() {
+  const int NL = 2, N = 20;
+  const double wl = 0.455, max_ratio = 0.6;
+  Problem problem;
+  problem.name = "directivity";
+  problem.function = [=](const double *x, long dimension) {  // NOLINT
+    double Rd;
+    std::vector<double> RL;
+    std::vector< std::complex<double> > eL;
+    if (!decode_design(x, NL, 1., RL, eL, Rd)) return 0.;
+    double D = evaluate_directivity(RL, eL, Rd, wl, 1., 0., 0., 0., 0., N);
+    if (std::isnan(D)) return 0.;
+    return -D;
+  };
+  problem.lbound = {wl*1e-3, 0., 0., 1., 1.};
+  problem.ubound = {wl*2., wl*max_ratio, wl*max_ratio, 30., 30.};
+  problem.stop = -std::numeric_limits<double>::infinity();
+  problem.target = problem.stop;
+  return problem;
+}  // end of Problem DirectivityProblem()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Fitness of the problem for the engine, recording the trace
+/// of a run as pairs (evaluations, best fitness so far).
+template <class Engine>
+void SetTracedFitness(const Problem &problem, Engine *engine, long *count,  // NOLINT
+                      double *best, std::vector<double> *trace) {
+  if (problem.batch) {
+    engine->BatchFitnessFunction = [=](const double *x, long size,  // NOLINT
+                                       long d, double *fitness) {  // NOLINT
+      problem.batch(x, size, d, fitness);
+      for (long i = 0; i < size; ++i) {  // NOLINT
+        ++(*count);
+        if (fitness[i] < *best) {
+          *best = fitness[i];
+          trace->push_back(*count);
+          trace->push_back(fitness[i]);
+        }
+      }
+    };
+    return;
+  }
+  engine->FitnessFunction = [=](const double *x, long d) {  // NOLINT
+    const double f = problem.function(x, d);
+#pragma omp critical(jbenchmark_trace)
+    {
+      ++(*count);
+      if (f < *best) {
+        *best = f;
+        trace->push_back(*count);
+        trace->push_back(f);
+      }
+    }
+    return f;
+  };
+}  // end of void SetTracedFitness()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Best-so-far trace of a run as pairs (evaluations, fitness).
+std::vector<double> RunStrategy(const Problem &problem,
+                                const Strategy &strategy,
+                                long evaluations, unsigned long seed) {  // NOLINT
+  const long dimension = problem.lbound.size();  // NOLINT
+  const long population =  // NOLINT
+    strategy.population + strategy.per_dimension*dimension;
+  std::vector<double> trace;
+  long count = 0;  // NOLINT
+  double best = std::numeric_limits<double>::infinity();
+  if (strategy.engine != kJADE) {
+    // Single-process engines run to the budget.
+    jade::CMAES cma;
+    jade::OnePlusOne es;
+    jade::Genetic ga;
+    jade::Optimizer *engine = &cma;
+    if (strategy.engine == kOnePlusOne) engine = &es;
+    if (strategy.engine == kGenetic) engine = &ga;
+    SetTracedFitness(problem, engine, &count, &best, &trace);
+    engine->Init(dimension);
+    engine->SetSeed(seed);
+    engine->SetAllBoundsVectors(problem.lbound, problem.ubound);
+    engine->SetTargetToMinimum();
+    engine->SetEvaluationBudget(evaluations);
+    if (strategy.engine == kCMAES) cma.SetRestarts(jade::kBIPOP, evaluations);
+    if (strategy.engine == kGenetic) {
+      ga.SetPopulation(population);
+      ga.SetGenerations(evaluations);
+    }
+    engine->RunOptimization();
+    return trace;
+  }
+  jade::SubPopulation sube;
+  SetTracedFitness(problem, &sube, &count, &best, &trace);
+  sube.Init(population, dimension);
+  sube.SetCommunicator(MPI_COMM_SELF);
+  sube.SetSeed(seed);
+  sube.SetVerbose(false);
+  sube.SetAllBoundsVectors(problem.lbound, problem.ubound);
+  sube.SetTargetToMinimum();
+  sube.SetHistoryMemory(strategy.memory);
+  if (strategy.min_population > 0)
+    sube.SetPopulationReduction(strategy.min_population, evaluations);
+  if (strategy.polish > 0) {
+    // Descents are limited by the budget of the run.
+    sube.SetPolishing(strategy.polish, 1, 0);
+    sube.SetEvaluationBudget(evaluations);
+  }
+  sube.SetSurrogate(strategy.surrogate, 4, 0.);
+  sube.SetTotalGenerationsMax(0);
+  sube.RunOptimization();
+  while (count + sube.GetPopulation() <= evaluations && best > problem.stop
+         && !sube.IsFinished())
+    sube.ContinueOptimization(1);
+  return trace;
+}  // end of std::vector<double> RunStrategy()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  const std::string dimension_list = argc > 1 ? argv[1] : "30";
+  const long evaluations = argc > 2 ? std::atol(argv[2]) : 300000;  // NOLINT
+  const int runs = argc > 3 ? std::atoi(argv[3]) : 5;
+  const std::string names = argc > 4 ? argv[4] : "all";
+  const std::string strategy_names = argc > 5 ? argv[5] : "all";
+  std::vector<long> dimensions;  // NOLINT
+  std::istringstream dimension_items(dimension_list);
+  std::string item;
+  while (std::getline(dimension_items, item, ','))
+    dimensions.push_back(std::atol(item.c_str()));
+  std::vector<Problem> problems;
+  std::istringstream list(names);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    for (long dimension : dimensions) {  // NOLINT
+      for (const auto &f : jade::TestFunctions()) {
+        if (name != "all" && name != f.name) continue;
+        const double minimum = f.minimum + dimension*f.minimum_per_dimension;
+        const double tolerance =
+          std::string(f.name) == "f7" ? 1e-8 + dimension/2. : 1e-8;
+        problems.push_back({f.name, f.function, f.batch,
+              std::vector<double>(dimension, f.lbound),
+              std::vector<double>(dimension, f.ubound),
+              minimum + tolerance, minimum + tolerance});
+      }
+    }
+    if (name == "all" || name == "directivity")
+      problems.push_back(DirectivityProblem());
+  }  // end of parsing problems
+  const std::vector<Strategy> all_strategies = {
+    {"JADE", kJADE, 100, 0, 0, 0, 0, 0},
+    {"SHADE", kJADE, 100, 0, 0, 6, 0, 0},
+    {"JADE-LPSR", kJADE, 0, 18, 4, 0, 0, 0},
+    {"L-SHADE", kJADE, 0, 18, 4, 6, 0, 0},
+    {"JADE-LBFGS", kJADE, 100, 0, 0, 0, 50, 0},
+    {"JADE-GP", kJADE, 100, 0, 0, 0, 0, 200},
+    {"CMA-ES", kCMAES, 0, 0, 0, 0, 0, 0},
+    {"1+1-ES", kOnePlusOne, 0, 0, 0, 0, 0, 0},
+    {"GA", kGenetic, 20, 0, 0, 0, 0, 0}};
+  std::vector<Strategy> strategies;
+  for (const auto &strategy : all_strategies)
+    if (strategy_names == "all"
+        || ("," + strategy_names + ",").find(
+            "," + std::string(strategy.name) + ",") != std::string::npos)
+      strategies.push_back(strategy);
+  if (strategies.empty() || dimensions.empty() || problems.empty()) {
+    if (rank == 0) printf("Nothing to run, check the arguments.\n");
+    MPI_Finalize();
+    return 1;
+  }
+  const long tasks = problems.size()*strategies.size()*runs;  // NOLINT
+  // Records of [task, trace size, trace...].
+  std::vector<double> records;
+  for (long task = rank; task < tasks; task += size) {  // NOLINT
+    const long p = task/(strategies.size()*runs);  // NOLINT
+    const long s = task/runs % strategies.size();  // NOLINT
+    std::vector<double> trace = RunStrategy(problems[p], strategies[s],
+                                            evaluations, task % runs + 1);
+    records.push_back(task);
+    records.push_back(trace.size());
+    records.insert(records.end(), trace.begin(), trace.end());
+  }  // end of for each task of this process
+  int count = records.size();
+  std::vector<int> counts(size), displacements(size);
+  MPI_Gather(&count, 1, MPI_INT, &counts.front(), 1, MPI_INT, 0,
+             MPI_COMM_WORLD);
+  std::vector<double> all;
+  if (rank == 0) {
+    for (int r = 1; r < size; ++r)
+      displacements[r] = displacements[r - 1] + counts[r - 1];
+    all.resize(displacements[size - 1] + counts[size - 1] + 1);
+  }
+  MPI_Gatherv(records.empty() ? nullptr : &records.front(), count,
+              MPI_DOUBLE, all.data(), &counts.front(),
+              &displacements.front(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  if (rank == 0) {
+    all.pop_back();
+    std::vector<std::vector<double> > traces(tasks);
+    for (unsigned long i = 0; i < all.size();) {
+      const long task = all[i], n = all[i + 1];  // NOLINT
+      traces[task].assign(&all[i + 2], &all[i + 2] + n);
+      i += 2 + n;
+    }
+    printf("# dimensions %s, budget %li evaluations, %i runs\n",
+           dimension_list.c_str(), evaluations, runs);
+    printf("# %-12s %4s %-10s %8s %14s %14s\n", "problem", "dim",
+           "strategy", "success", "evaluations", "mean best");
+    for (unsigned long p = 0; p < problems.size(); ++p) {
+      double target = problems[p].target;
+      const long first = p*strategies.size()*runs;  // NOLINT
+      if (std::isinf(target)) {
+        // 99% of the best directivity found by any run.
+        double best = 0;
+        for (long t = first; t < first + static_cast<long>(strategies.size())*runs; ++t)  // NOLINT
+          if (!traces[t].empty()) best = std::min(best, traces[t].back());
+        target = 0.99*best;
+      }
+      for (unsigned long s = 0; s < strategies.size(); ++s) {
+        std::vector<double> hits;
+        double mean_best = 0;
+        for (int r = 0; r < runs; ++r) {
+          const std::vector<double> &trace = traces[first + s*runs + r];
+          for (unsigned long i = 0; i < trace.size(); i += 2) {
+            if (trace[i + 1] > target) continue;
+            hits.push_back(trace[i]);
+            break;
+          }
+          if (!trace.empty()) mean_best += trace.back()/runs;
+        }  // end of for each run
+        std::sort(hits.begin(), hits.end());
+        const long dimension = problems[p].lbound.size();  // NOLINT
+        if (hits.empty())
+          printf("  %-12s %4li %-10s %4li/%-3i %14s %14.4g\n",
+                 problems[p].name.c_str(), dimension, strategies[s].name,
+                 0L, runs, "-", mean_best);
+        else
+          printf("  %-12s %4li %-10s %4li/%-3i %14.0f %14.4g\n",
+                 problems[p].name.c_str(), dimension, strategies[s].name,
+                 static_cast<long>(hits.size()), runs,  // NOLINT
+                 hits[hits.size()/2], mean_best);
+      }  // end of for each strategy
+    }  // end of for each problem
+  }  // end of output
+  MPI_Finalize();
+  return 0;
+}  // end of int main()
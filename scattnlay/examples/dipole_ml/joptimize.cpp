@@ -0,0 +1,581 @@
+///
+/// @file   joptimize.cpp
+/// @brief  MPI driver of JADE++ for directivity optimization of a dipole
+/// in a multilayer sphere, a native replacement of optimize.py.
+///
+/// Usage: mpirun -np <n> ./joptimize [config]
+///
+/// The config is a list of "key value" lines, '#' starts a comment.
+/// Keys (defaults are the ones of optimize.py):
+///   NL 3            number of layers
+///   N 50            number of multipoles
+///   wl 0.455        wavelength
+///   px 1, py 0, pz 0  dipole amplitudes
+///   th 0, ph 0      direction of the directivity
+///   host_index 1    refractive index of the host medium
+///   min_index 1, max_index 30   bounds of the layer indices
+///   rd_min 1e-3, rd_max 2       bounds of the dipole position (in wl)
+///   ratio_start 0.1, ratio_stop 2.000005, ratio_step 0.05
+///                   max_ratio sweep (numpy.arange semantics), the
+///                   radii are searched in (0, wl*max_ratio)
+///   population 75, generations 6000, report 1000
+///   seed 0          nonzero: reproducible runs
+///   evaluations 0   nonzero: budget of fitness evaluations of a sweep
+///                   point, the run stops at `generations` or when the
+///                   next generation would exceed the budget; at
+///                   least `population` (the initial evaluations)
+///   tol_fitness 0, tol_diameter 0, stall 0
+///                   nonzero: the population has collapsed when the
+///                   fitness spread, the largest coordinate range
+///                   relative to the bounds or the generations without
+///                   improvement of the best reach these values
+///   restarts 0      nonzero (>= 1): a collapsed population restarts
+///                   from new random vectors with its size multiplied
+///                   by this factor (IPOP), 0: the run stops instead.
+///                   Islands restart independently and stop together.
+///                   Asynchronous runs use the budget only
+///   polish_count 0  nonzero: hybrid search, the polish_count best
+///                   individuals of each process are refined by a
+///                   projected L-BFGS descent (finite-difference
+///                   gradients) and put back into the population
+///   polish_interval 0  generations between polishing, 0: only when
+///                   the run stops early; with a divisor of
+///                   `generations` the final best is polished too
+///   polish_evaluations 0  nonzero: evaluations of one descent,
+///                   0: until it converges (within `evaluations`)
+///   surrogate 0     nonzero: a Gaussian-process model of this many
+///                   recently evaluated points pre-screens the trial
+///                   vectors, only the most promising of
+///   surrogate_candidates 4  trial vectors of an individual is
+///                   evaluated; the screened out ones are printed for
+///                   each point
+///   surrogate_kappa 0  a trial is ranked by its predicted fitness +
+///                   surrogate_kappa standard deviations
+///   warm_start 0    nonzero: each group of `islands` processes sweeps
+///                   a contiguous block of points upwards, a point
+///                   starts from the warm_start best individuals of the
+///                   previous point of the block as they are and with
+///                   Rd and the radii rescaled by the ratio of the
+///                   max_ratio values (up to population - 1 of them),
+///                   the first point of a block starts at random
+///   warm_evaluations 0  nonzero: evaluation budget of warm-started
+///                   points instead of `evaluations`
+///   islands 1       MPI processes per sweep point, >1 runs the island
+///                   model of JADE++ over them
+///   topology ring   ring, random or full migration topology
+///   migration_interval 20, migrants 2
+///   replacement worst  immigrants replace worst or random individuals
+///   async 0         1: each group of `islands` processes runs one
+///                   asynchronous steady-state JADE, the first process
+///                   coordinates, the others evaluate
+///   pareto 0        1: instead of the sweep, a single NSGA-II run over
+///                   all MPI processes searches the trade-off front of
+///                   directivity (max), radiated power relative to the
+///                   dipole in the host medium (max) and outer radius
+///                   (min) with the radii in (0, wl*ratio_stop);
+///                   `population`, `generations`, `evaluations` and
+///                   `seed` apply, every batch of evaluations is split
+///                   over the processes. The front is written to
+///                   <output>pareto-<sign>.txt as lines
+///                   "ratio D P [Rd, R1.., n1..]", ratio = outer
+///                   radius/wl, in increasing ratio
+///   store           file of the evaluation store (none by default):
+///                   solved designs are memoized there, shared by all
+///                   processes and later runs, see evalstore.h; a new
+///                   store is a sparse file of about 1 GiB
+///   output out2_    prefix of the output file
+///   checkpoint      prefix of checkpoint files (none by default), the
+///                   state of sweep point i is saved to
+///                   <checkpoint>point<i>[.rank] every
+///   checkpoint_interval 100  generations; a run restarted with the
+///                   same config resumes every point from its file and
+///                   reports from the checkpoint generation on
+///
+/// Sweep points are distributed round-robin (in blocks with warm_start)
+/// over groups of `islands` MPI processes, each point is optimized by a
+/// single group. Every `report` generations the line
+/// "n_total max_ratio fit [Rd, R1.., n1..]" is recorded and appended at
+/// once to <sign>.group<g>.txt of the group, at the end rank 0 writes
+/// all of them in sweep order to <sign>.txt, where <sign> is
+/// <output>index<max_index>-N<N>-NL<NL>-iterations<generations>-<random>,
+/// with the same schema as optimize.py, so large-plot.py reads it as is.
+/// Fitness evaluations of a generation run in OpenMP threads
+/// (OMP_NUM_THREADS per process).
+#include <mpi.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./jade.h"
+#include "./nsga2.h"
+#include "./directivity.h"
+#include "./evalstore.h"
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+struct RunConfig {
+  int NL = 3, N = 50;
+  double wl = 0.455, px = 1., py = 0., pz = 0., th = 0., ph = 0.;
+  double host_index = 1., min_index = 1., max_index = 30.;
+  double rd_min = 1e-3, rd_max = 2.;
+  double ratio_start = 0.1, ratio_stop = 2.000005, ratio_step = 0.05;
+  long population = 75, generations = 6000, report = 1000;  // NOLINT
+  unsigned long seed = 0;  // NOLINT
+  long evaluations = 0, stall = 0;  // NOLINT
+  double tol_fitness = 0., tol_diameter = 0., restarts = 0.;
+  int islands = 1;
+  std::string topology = "ring", replacement = "worst";
+  long migration_interval = 20, migrants = 2;  // NOLINT
+  int async = 0;
+  std::string output = "out2_", checkpoint, store;
+  long checkpoint_interval = 100;  // NOLINT
+  long warm_start = 0, warm_evaluations = 0;  // NOLINT
+  long polish_interval = 0, polish_count = 0, polish_evaluations = 0;  // NOLINT
+  long surrogate = 0, surrogate_candidates = 4;  // NOLINT
+  double surrogate_kappa = 0.;
+  int pareto = 0;
+};
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void ReadConfig(const std::string &file_name, RunConfig *config) {
+  std::ifstream file(file_name);
+  if (!file) throw std::invalid_argument("Cannot open config " + file_name);
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string key;
+    if (!(words >> key)) continue;
+    bool ok = true;
+    if (key == "NL") ok = static_cast<bool>(words >> config->NL);
+    else if (key == "N") ok = static_cast<bool>(words >> config->N);
+    else if (key == "wl") ok = static_cast<bool>(words >> config->wl);
+    else if (key == "px") ok = static_cast<bool>(words >> config->px);
+    else if (key == "py") ok = static_cast<bool>(words >> config->py);
+    else if (key == "pz") ok = static_cast<bool>(words >> config->pz);
+    else if (key == "th") ok = static_cast<bool>(words >> config->th);
+    else if (key == "ph") ok = static_cast<bool>(words >> config->ph);
+    else if (key == "host_index")
+      ok = static_cast<bool>(words >> config->host_index);
+    else if (key == "min_index")
+      ok = static_cast<bool>(words >> config->min_index);
+    else if (key == "max_index")
+      ok = static_cast<bool>(words >> config->max_index);
+    else if (key == "rd_min") ok = static_cast<bool>(words >> config->rd_min);
+    else if (key == "rd_max") ok = static_cast<bool>(words >> config->rd_max);
+    else if (key == "ratio_start")
+      ok = static_cast<bool>(words >> config->ratio_start);
+    else if (key == "ratio_stop")
+      ok = static_cast<bool>(words >> config->ratio_stop);
+    else if (key == "ratio_step")
+      ok = static_cast<bool>(words >> config->ratio_step);
+    else if (key == "population")
+      ok = static_cast<bool>(words >> config->population);
+    else if (key == "generations")
+      ok = static_cast<bool>(words >> config->generations);
+    else if (key == "report") ok = static_cast<bool>(words >> config->report);
+    else if (key == "seed") ok = static_cast<bool>(words >> config->seed);
+    else if (key == "evaluations")
+      ok = static_cast<bool>(words >> config->evaluations);
+    else if (key == "tol_fitness")
+      ok = static_cast<bool>(words >> config->tol_fitness);
+    else if (key == "tol_diameter")
+      ok = static_cast<bool>(words >> config->tol_diameter);
+    else if (key == "stall") ok = static_cast<bool>(words >> config->stall);
+    else if (key == "restarts")
+      ok = static_cast<bool>(words >> config->restarts);
+    else if (key == "polish_interval")
+      ok = static_cast<bool>(words >> config->polish_interval);
+    else if (key == "polish_count")
+      ok = static_cast<bool>(words >> config->polish_count);
+    else if (key == "polish_evaluations")
+      ok = static_cast<bool>(words >> config->polish_evaluations);
+    else if (key == "surrogate")
+      ok = static_cast<bool>(words >> config->surrogate);
+    else if (key == "surrogate_candidates")
+      ok = static_cast<bool>(words >> config->surrogate_candidates);
+    else if (key == "surrogate_kappa")
+      ok = static_cast<bool>(words >> config->surrogate_kappa);
+    else if (key == "warm_start")
+      ok = static_cast<bool>(words >> config->warm_start);
+    else if (key == "warm_evaluations")
+      ok = static_cast<bool>(words >> config->warm_evaluations);
+    else if (key == "islands") ok = static_cast<bool>(words >> config->islands);
+    else if (key == "topology")
+      ok = static_cast<bool>(words >> config->topology);
+    else if (key == "migration_interval")
+      ok = static_cast<bool>(words >> config->migration_interval);
+    else if (key == "migrants")
+      ok = static_cast<bool>(words >> config->migrants);
+    else if (key == "replacement")
+      ok = static_cast<bool>(words >> config->replacement);
+    else if (key == "async") ok = static_cast<bool>(words >> config->async);
+    else if (key == "pareto") ok = static_cast<bool>(words >> config->pareto);
+    else if (key == "output") ok = static_cast<bool>(words >> config->output);
+    else if (key == "store") ok = static_cast<bool>(words >> config->store);
+    else if (key == "checkpoint")
+      ok = static_cast<bool>(words >> config->checkpoint);
+    else if (key == "checkpoint_interval")
+      ok = static_cast<bool>(words >> config->checkpoint_interval);
+    else throw std::invalid_argument("Unknown config key " + key);
+    if (!ok) throw std::invalid_argument("Wrong value for config key " + key);
+  }  // end of for each line
+  if (config->NL < 1 || config->N < 2 || config->ratio_step <= 0
+      || config->report < 1 || config->generations < 1 || config->islands < 1
+      || config->checkpoint_interval < 1
+      || config->evaluations < 0 || config->stall < 0
+      || (config->evaluations > 0 && config->evaluations < config->population)
+      || (config->warm_evaluations > 0
+          && config->warm_evaluations < config->population)
+      || config->tol_fitness < 0 || config->tol_diameter < 0
+      || config->warm_start < 0 || config->warm_evaluations < 0
+      || config->polish_interval < 0 || config->polish_count < 0
+      || config->polish_evaluations < 0
+      || (config->surrogate != 0 && config->surrogate < 4)
+      || config->surrogate_candidates < 1 || config->surrogate_kappa < 0
+      || (config->pareto && config->population < 2)
+      || (config->restarts != 0 && config->restarts < 1)
+      || (config->topology != "ring" && config->topology != "random"
+          && config->topology != "full")
+      || (config->replacement != "worst" && config->replacement != "random"))
+    throw std::invalid_argument("Wrong run config!");
+}  // end of void ReadConfig()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Problem of the current sweep point, read by the objective
+/// functions below.
+RunConfig config;
+double max_ratio = 0;
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Same as fitness2() of optimize.py, x = [Rd, radii, indices],
+/// on the canonical design.
+double DirectivityFitness(const double *x, long dimension) {  // NOLINT
+  double Rd;
+  std::vector<double> RL;
+  std::vector< std::complex<double> > eL;
+  if (!decode_design(x, config.NL, config.host_index, RL, eL, Rd)) return 0.;
+  double D = evaluate_directivity(RL, eL, Rd, config.wl,
+                                  config.px, config.py, config.pz,
+                                  config.th, config.ph, config.N);
+  if (std::isnan(D)) return 0.;
+  return D;
+}  // end of double DirectivityFitness()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Objectives of the pareto mode: directivity, radiated power
+/// relative to the host medium and outer radius in wavelengths of the
+/// canonical design.
+void EmissionObjectives(const double *x, long dimension,  // NOLINT
+                        double *objectives) {
+  double Rd;
+  std::vector<double> RL;
+  std::vector< std::complex<double> > eL;
+  const bool valid = decode_design(x, config.NL, config.host_index,
+                                   RL, eL, Rd);
+  objectives[0] = objectives[1] = 0.;
+  objectives[2] = RL.back()/config.wl;
+  if (!valid) return;
+  const Emission E = evaluate_emission(RL, eL, Rd, config.wl,
+                                       config.px, config.py, config.pz,
+                                       config.th, config.ph, config.N);
+  objectives[0] = E.D;
+  objectives[1] = E.P;
+}  // end of void EmissionObjectives()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Line of the output file for a record [point, n_total,
+/// fitness, best vector...].
+void WriteRecord(const double *r, long dim, std::ostream *file) {  // NOLINT
+  (*file) << static_cast<long>(r[1]) << ' '
+          << config.ratio_start + r[0]*config.ratio_step << ' ' << r[2]
+          << " [";
+  for (long c = 0; c < dim; ++c) (*file) << (c ? ", " : "") << r[3 + c];  // NOLINT
+  (*file) << "]\n";
+}  // end of void WriteRecord()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Individuals of the sweep point at ratio `from` moved to the
+/// point at ratio `to`: each of them as it is and with Rd and the radii
+/// scaled by to/from, clipped to the bounds.
+std::vector<std::vector<double> > RescaleElite(
+    const std::vector<std::vector<double> > &elite, double from, double to,
+    const std::vector<double> &lbound, const std::vector<double> &ubound) {
+  std::vector<std::vector<double> > feed;
+  for (int scaled = 0; scaled < 2; ++scaled) {
+    for (auto x : elite) {
+      for (int i = 0; i < 1 + config.NL && scaled; ++i) x[i] *= to/from;
+      for (unsigned long i = 0; i < x.size(); ++i)
+        x[i] = std::min(std::max(x[i], lbound[i]), ubound[i]);
+      feed.push_back(x);
+    }
+  }
+  return feed;
+}  // end of std::vector<std::vector<double> > RescaleElite()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief Optimizes sweep point `point` by the island group `island`,
+/// records are appended to `records` of the group root as
+/// [point, n_total, fitness, best vector...] and streamed to `stream`.
+/// The run starts from the `elite` of the sweep point `elite_point`
+/// (none if empty) and leaves its own elite there.
+void OptimizeSweepPoint(long point, MPI_Comm island,  // NOLINT
+                        std::vector<double> *records, std::ostream *stream,
+                        long elite_point,  // NOLINT
+                        std::vector<std::vector<double> > *elite) {
+  const long dim = 2*config.NL + 1;  // NOLINT
+  max_ratio = config.ratio_start + point*config.ratio_step;
+  std::vector<double> lbound(dim), ubound(dim);
+  lbound[0] = config.wl*config.rd_min;
+  ubound[0] = config.wl*config.rd_max;
+  for (int i = 0; i < config.NL; ++i) {
+    lbound[1 + i] = 0.;
+    ubound[1 + i] = config.wl*max_ratio;
+    lbound[1 + config.NL + i] = config.min_index;
+    ubound[1 + config.NL + i] = config.max_index;
+  }
+  jade::SubPopulation sube;
+  sube.FitnessFunction = DirectivityFitness;
+  sube.Init(config.population, dim);
+  sube.SetCommunicator(island);
+  int island_rank, islands;
+  MPI_Comm_rank(island, &island_rank);
+  MPI_Comm_size(island, &islands);
+  if (config.seed) sube.SetSeed(config.seed + point*islands + island_rank);
+  if (islands > 1 && config.async) {
+    sube.SetDistributionLevel(2);
+  } else if (islands > 1) {
+    sube.SetDistributionLevel(1);
+    jade::Topology topology = jade::kRing;
+    if (config.topology == "random") topology = jade::kRandom;
+    if (config.topology == "full") topology = jade::kFullyConnected;
+    sube.SetMigration(topology, config.migration_interval, config.migrants,
+                      config.replacement == "random" ? jade::kReplaceRandom
+                      : jade::kReplaceWorst);
+  }
+  sube.SetAllBoundsVectors(lbound, ubound);
+  sube.SetTargetToMaximum();
+  const bool is_warm = config.warm_start > 0 && !elite->empty();
+  if (is_warm) {
+    std::vector<std::vector<double> > feed = RescaleElite(
+        *elite, config.ratio_start + elite_point*config.ratio_step,
+        max_ratio, lbound, ubound);
+    if (static_cast<long>(feed.size()) >= config.population)  // NOLINT
+      feed.resize(config.population - 1);
+    sube.SetFeed(feed);
+  }
+  sube.SetEvaluationBudget(is_warm && config.warm_evaluations > 0
+                           ? config.warm_evaluations : config.evaluations);
+  sube.SetConvergence(config.tol_fitness, config.tol_diameter, config.stall);
+  sube.SetRestarts(config.restarts);
+  sube.SetPolishing(config.polish_interval, config.polish_count,
+                    config.polish_evaluations);
+  sube.SetSurrogate(config.surrogate, config.surrogate_candidates,
+                    config.surrogate_kappa);
+  if (!config.checkpoint.empty())
+    sube.SetCheckpoint(config.checkpoint + "point" + std::to_string(point),
+                       config.checkpoint_interval);
+  long chunk = std::min(config.report, config.generations);  // NOLINT
+  sube.SetTotalGenerationsMax(chunk);
+  if (sube.RunOptimization() != jade::kDone)
+    throw std::runtime_error("JADE optimization failed!");
+  while (true) {
+    double fit = 0;
+    std::vector<double> best = sube.GetGlobalBest(&fit);
+    if (island_rank == 0) {
+      records->push_back(point);
+      records->push_back(sube.GetCurrentGeneration());
+      records->push_back(fit);
+      records->insert(records->end(), best.begin(), best.end());
+      WriteRecord(&records->back() - (2 + dim), dim, stream);
+      stream->flush();
+      printf("==> %li %g %g\n", sube.GetCurrentGeneration(), max_ratio, fit);
+      fflush(stdout);
+    }
+    chunk = std::min(config.report,
+                     config.generations - sube.GetCurrentGeneration());
+    if (chunk < 1 || sube.IsFinished()) break;
+    if (sube.ContinueOptimization(chunk) != jade::kDone)
+      throw std::runtime_error("JADE optimization failed!");
+  }  // end of reporting
+  sube.PrintUtilization();
+  if (config.surrogate > 0)
+    printf("Surrogate of rank %i at point %li: %li evaluations, %li trials "
+           "screened out\n", island_rank, point, sube.GetEvaluations(),
+           sube.GetScreenedTrials());
+  if (config.warm_start > 0) *elite = sube.GetElite(config.warm_start);
+}  // end of void OptimizeSweepPoint()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+/// @brief The pareto mode: every process runs the same NSGA-II search
+/// and evaluates its share of each batch, the objectives are summed
+/// over the processes. The output process writes the front.
+void OptimizePareto(const std::string &file_name) {
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  const long dim = 2*config.NL + 1;  // NOLINT
+  std::vector<double> lbound(dim), ubound(dim);
+  lbound[0] = config.wl*config.rd_min;
+  ubound[0] = config.wl*config.rd_max;
+  for (int i = 0; i < config.NL; ++i) {
+    lbound[1 + i] = 0.;
+    ubound[1 + i] = config.wl*config.ratio_stop;
+    lbound[1 + config.NL + i] = config.min_index;
+    ubound[1 + config.NL + i] = config.max_index;
+  }
+  jade::NSGA2 nsga;
+  nsga.Init(dim);
+  unsigned long seed = config.seed;  // NOLINT
+  if (!seed) {
+    std::random_device rd;
+    seed = (static_cast<unsigned long>(rd()) << 32) ^ rd();  // NOLINT
+  }
+  MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG, jade::kOutput, MPI_COMM_WORLD);
+  nsga.SetSeed(seed);
+  nsga.SetVerbose(rank == jade::kOutput);
+  nsga.SetAllBoundsVectors(lbound, ubound);
+  nsga.SetObjectives({true, true, false});
+  nsga.SetPopulation(config.population);
+  nsga.SetGenerations(config.generations);
+  nsga.SetEvaluationBudget(config.evaluations);
+  std::vector<double> share;
+  nsga.BatchObjectivesFunction = [&](const double *x, long count,  // NOLINT
+                                     long dimension, double *objectives) {  // NOLINT
+    share.assign(3*count, 0.);
+#pragma omp parallel for schedule(dynamic)
+    for (long i = rank; i < count; i += size)  // NOLINT
+      EmissionObjectives(x + i*dimension, dimension, &share[3*i]);
+    MPI_Allreduce(share.data(), objectives, 3*count, MPI_DOUBLE, MPI_SUM,
+                  MPI_COMM_WORLD);
+  };
+  nsga.RunOptimization();
+  if (rank != jade::kOutput) return;
+  std::vector<std::vector<double> > objectives;
+  std::vector<std::vector<double> > front = nsga.GetFront(&objectives);
+  std::vector<long> order(front.size());  // NOLINT
+  for (unsigned long i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](long a, long b) {
+      return objectives[a][2] < objectives[b][2];
+    });
+  std::ofstream file(file_name);
+  file.precision(17);
+  for (auto i : order) {
+    file << objectives[i][2] << ' ' << objectives[i][0] << ' '
+         << objectives[i][1] << " [";
+    for (long c = 0; c < dim; ++c) file << (c ? ", " : "") << front[i][c];  // NOLINT
+    file << "]\n";
+  }
+  printf("--final--\n%s\n", file_name.c_str());
+}  // end of void OptimizePareto()
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  try {
+    if (argc > 1) ReadConfig(argv[1], &config);
+  } catch(const std::exception &ex) {
+    if (rank == jade::kOutput) std::cerr << ex.what() << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+  try {
+    if (!config.store.empty()) open_eval_store(config.store);
+  } catch(const std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+  const long dim = 2*config.NL + 1;  // NOLINT
+  const long record_size = 3 + dim;  // NOLINT
+  // numpy.arange(ratio_start, ratio_stop, ratio_step)
+  const long points = static_cast<long>(  // NOLINT
+      std::ceil((config.ratio_stop - config.ratio_start)/config.ratio_step));
+  // Same run signature for all processes.
+  int run_id = 0;
+  if (rank == jade::kOutput) {
+    std::random_device rd;
+    run_id = std::uniform_int_distribution<int>(0, 99999)(rd);
+  }
+  MPI_Bcast(&run_id, 1, MPI_INT, jade::kOutput, MPI_COMM_WORLD);
+  char sign[256];
+  snprintf(sign, sizeof(sign), "index%03.2g-N%i-NL%i-iterations%li-%05i",
+           config.max_index, config.N, config.NL, config.generations,
+           run_id);
+  if (config.pareto) {
+    OptimizePareto(config.output + "pareto-" + sign + ".txt");
+    MPI_Finalize();
+    return 0;
+  }
+  // Groups of consecutive ranks optimize the same sweep points.
+  const int islands = std::min(config.islands, size);
+  const int groups = (size + islands - 1)/islands;
+  const int group = rank/islands;
+  MPI_Comm island;
+  MPI_Comm_split(MPI_COMM_WORLD, group, rank, &island);
+  std::ofstream stream;
+  if (rank % islands == 0) {
+    stream.open(config.output + sign + ".group" + std::to_string(group)
+                + ".txt");
+    stream.precision(17);
+  }
+  std::vector<double> records;
+  std::vector<std::vector<double> > elite;
+  if (config.warm_start > 0) {
+    // Contiguous blocks, each swept upwards from a random start.
+    const long first = points*group/groups;  // NOLINT
+    const long last = points*(group + 1)/groups;  // NOLINT
+    for (long point = first; point < last; ++point)  // NOLINT
+      OptimizeSweepPoint(point, island, &records, &stream, point - 1, &elite);
+  } else {
+    for (long point = group; point < points; point += groups)  // NOLINT
+      OptimizeSweepPoint(point, island, &records, &stream, -1, &elite);
+  }
+  MPI_Comm_free(&island);
+  // Collect all records at the output process.
+  int count = records.size();
+  std::vector<int> counts(size), displs(size);
+  MPI_Gather(&count, 1, MPI_INT, &counts.front(), 1, MPI_INT,
+             jade::kOutput, MPI_COMM_WORLD);
+  int total = 0;
+  for (int i = 0; i < size; ++i) {
+    displs[i] = total;
+    total += counts[i];
+  }
+  std::vector<double> all(std::max(total, 1));
+  MPI_Gatherv(records.data(), count, MPI_DOUBLE, &all.front(),
+              &counts.front(), &displs.front(), MPI_DOUBLE,
+              jade::kOutput, MPI_COMM_WORLD);
+  if (rank == jade::kOutput) {
+    std::vector<long> order(total/record_size);  // NOLINT
+    for (unsigned long i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](long a, long b) {
+        return all[a*record_size] < all[b*record_size];
+      });
+    std::ofstream file(config.output + sign + ".txt");
+    file.precision(17);
+    for (auto i : order) WriteRecord(&all[i*record_size], dim, &file);
+    printf("--final--\n%s\n", (config.output + sign + ".txt").c_str());
+  }  // end of output
+  MPI_Finalize();
+  return 0;
+}  // end of int main()
@@ -0,0 +1,269 @@
+///
+/// @file   lbfgs.cpp
+/// @brief  Projected L-BFGS with batched finite-difference gradients.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./lbfgs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <string>
+#include <vector>
+namespace jade {
+  namespace {
+    /// @brief Sufficient decrease of the Armijo condition.
+    const double kArmijo = 1e-4;
+    /// @brief Largest move of the first step (without curvature pairs)
+    /// in scaled coordinates.
+    const double kFirstMove = 0.1;
+    const char kBudgetSpent[] = "budget";
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief Dot product over the free coordinates.
+    double Dot(const std::vector<double> &a, const std::vector<double> &b,
+               const std::vector<char> &is_free) {
+      double sum = 0.;
+      for (unsigned long i = 0; i < a.size(); ++i)                     // NOLINT
+        if (is_free[i]) sum += a[i]*b[i];
+      return sum;
+    }  // end of double Dot()
+  }  // end of namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int LBFGS::SetMemory(long pairs) {                                   // NOLINT
+    if (pairs < 1) throw std::invalid_argument("Memory should be >= 1!");
+    memory_ = pairs;
+    return kDone;
+  }  // end of int LBFGS::SetMemory(long pairs)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int LBFGS::SetStep(double step) {
+    if (!(step > 0 && step < 0.5))
+      throw std::invalid_argument("Difference step should be in (0, 0.5)!");
+    step_ = step;
+    return kDone;
+  }  // end of int LBFGS::SetStep(double step)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int LBFGS::SetLinePoints(long points) {                              // NOLINT
+    if (points < 1)
+      throw std::invalid_argument("Line search points should be >= 1!");
+    line_points_ = points;
+    return kDone;
+  }  // end of int LBFGS::SetLinePoints(long points)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int LBFGS::SetTolerances(double tol_grad, double tol_fun) {
+    if (tol_grad < 0 || tol_fun < 0)
+      throw std::invalid_argument("Tolerances should be >= 0!");
+    tol_grad_ = tol_grad;
+    tol_fun_ = tol_fun;
+    return kDone;
+  }  // end of int LBFGS::SetTolerances(double tol_grad, double tol_fun)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void LBFGS::ToPheno(const double *u, double *x) {
+    for (long i = 0; i < dimension_; ++i)                              // NOLINT
+      x[i] = std::min(ubound_[i], lbound_[i] + u[i]*(ubound_[i] - lbound_[i]));
+  }  // end of void LBFGS::ToPheno(const double *u, double *x)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool LBFGS::Gradient(const std::vector<double> &u,
+                       std::vector<double> *g) {
+    const long n = dimension_;                                         // NOLINT
+    if (!IsBudgetLeft(2*n)) return false;
+    // Central differences, shifted inside the box at the bounds.
+    std::vector<double> x(2*n*n), cost, lower(n), upper(n);
+    std::vector<double> v(u);
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      upper[i] = std::min(1., u[i] + step_);
+      lower[i] = std::max(0., u[i] - step_);
+      v[i] = upper[i];
+      ToPheno(&v.front(), &x[2*i*n]);
+      v[i] = lower[i];
+      ToPheno(&v.front(), &x[(2*i + 1)*n]);
+      v[i] = u[i];
+    }
+    EvaluateBatch(x, &cost);
+    g->resize(n);
+    for (long i = 0; i < n; ++i)                                       // NOLINT
+      (*g)[i] = (cost[2*i] - cost[2*i + 1])/(upper[i] - lower[i]);
+    return true;
+  }  // end of bool LBFGS::Gradient()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int LBFGS::RunOptimization() {
+    StartRun();
+    const long n = dimension_;                                         // NOLINT
+    if (!start_.empty() && static_cast<long>(start_.size()) != n)      // NOLINT
+      throw std::invalid_argument("Start point should have the dimension!");
+    std::vector<double> u(n), x(n), cost;
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      const double share = start_.empty() ? stream_.Uniform()
+        : (start_[i] - lbound_[i])/(ubound_[i] - lbound_[i]);
+      u[i] = std::min(1., std::max(0., share));
+    }
+    stop_reason_ = kBudgetSpent;
+    if (!IsBudgetLeft(1)) return kDone;
+    ToPheno(&u.front(), &x.front());
+    EvaluateBatch(x, &cost);
+    double f = cost.front();
+    std::vector<double> g, g_next, d(n), batch, trial;
+    std::vector<char> is_free(n);
+    std::deque<std::vector<double> > s_history, y_history;
+    std::deque<double> rho_history;
+    if (std::isinf(f)) {
+      stop_reason_ = "infeasible start";
+    } else if (Gradient(u, &g)) {
+      stop_reason_.clear();
+    }
+    while (stop_reason_.empty()) {
+      if (std::any_of(g.begin(), g.end(),
+                      [](double v) {return !std::isfinite(v);})) {
+        stop_reason_ = "infinite gradient";
+        break;
+      }
+      // Projected gradient, coordinates pushed out of the box are fixed.
+      double pg_max = 0.;
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        is_free[i] = !((u[i] <= 0. && g[i] > 0.) || (u[i] >= 1. && g[i] < 0.));
+        if (is_free[i]) pg_max = std::max(pg_max, std::abs(g[i]));
+      }
+      if (!(pg_max > tol_grad_*std::max(std::abs(f), 1.))) {
+        stop_reason_ = "gradient";
+        break;
+      }
+      // Two-loop recursion on the free coordinates.
+      for (long i = 0; i < n; ++i) d[i] = is_free[i] ? -g[i] : 0.;    // NOLINT
+      const long m = s_history.size();                                 // NOLINT
+      std::vector<double> alpha(m);
+      for (long k = m - 1; k >= 0; --k) {                              // NOLINT
+        alpha[k] = rho_history[k]*Dot(s_history[k], d, is_free);
+        for (long i = 0; i < n; ++i) d[i] -= alpha[k]*y_history[k][i];  // NOLINT
+      }
+      if (m > 0) {
+        const double yy = Dot(y_history.back(), y_history.back(), is_free);
+        const double sy = Dot(s_history.back(), y_history.back(), is_free);
+        const double gamma = sy > 0. && yy > 0. ? sy/yy : 1.;
+        for (long i = 0; i < n; ++i) d[i] *= gamma;                    // NOLINT
+      }
+      for (long k = 0; k < m; ++k) {                                   // NOLINT
+        const double beta = rho_history[k]*Dot(y_history[k], d, is_free);
+        for (long i = 0; i < n; ++i)                                   // NOLINT
+          d[i] += (alpha[k] - beta)*s_history[k][i];
+      }
+      for (long i = 0; i < n; ++i) if (!is_free[i]) d[i] = 0.;         // NOLINT
+      if (!(Dot(g, d, is_free) < 0.)) {
+        // Lost curvature information, restart from steepest descent.
+        s_history.clear();
+        y_history.clear();
+        rho_history.clear();
+        for (long i = 0; i < n; ++i) d[i] = is_free[i] ? -g[i] : 0.;  // NOLINT
+      }
+      double d_max = 0.;
+      for (long i = 0; i < n; ++i) d_max = std::max(d_max, std::abs(d[i]));  // NOLINT
+      double step = s_history.empty() ? std::min(1., kFirstMove/d_max) : 1.;
+      // Backtracking along the projected path, line_points_ halved
+      // steps per batch, the best one with sufficient decrease is taken.
+      long accepted = -1;                                              // NOLINT
+      double f_next = f;
+      std::vector<double> u_next;
+      while (accepted < 0) {
+        if (step*d_max < std::numeric_limits<double>::epsilon()) {
+          stop_reason_ = "line search";
+          break;
+        }
+        long size = line_points_;                                      // NOLINT
+        if (evaluation_budget_ > 0)
+          size = std::min(size, evaluation_budget_ - evaluations_);
+        if (size < 1) {
+          stop_reason_ = kBudgetSpent;
+          break;
+        }
+        trial.assign(size*n, 0.);
+        batch.assign(size*n, 0.);
+        for (long k = 0; k < size; ++k) {                              // NOLINT
+          const double t = step*std::pow(0.5, static_cast<double>(k));
+          for (long i = 0; i < n; ++i)                                 // NOLINT
+            trial[k*n + i] = std::min(1., std::max(0., u[i] + t*d[i]));
+          ToPheno(&trial[k*n], &batch[k*n]);
+        }
+        EvaluateBatch(batch, &cost);
+        for (long k = 0; k < size; ++k) {                              // NOLINT
+          double slope = 0.;
+          for (long i = 0; i < n; ++i)                                 // NOLINT
+            slope += g[i]*(trial[k*n + i] - u[i]);
+          if (cost[k] <= f + kArmijo*slope && cost[k] < f_next) {
+            accepted = k;
+            f_next = cost[k];
+          }
+        }
+        if (accepted >= 0)
+          u_next.assign(&trial[accepted*n], &trial[accepted*n] + n);
+        step *= std::pow(0.5, static_cast<double>(size));
+      }  // end of line search
+      if (accepted < 0) break;
+      ++generations_;
+      const double decrease = f - f_next;
+      std::vector<double> s(n);
+      for (long i = 0; i < n; ++i) s[i] = u_next[i] - u[i];            // NOLINT
+      u.swap(u_next);
+      f = f_next;
+      if (decrease <= tol_fun_*std::max(std::abs(f), 1.)) {
+        stop_reason_ = "fitness";
+        break;
+      }
+      if (!Gradient(u, &g_next)) {
+        stop_reason_ = kBudgetSpent;
+        break;
+      }
+      std::vector<double> y(n);
+      for (long i = 0; i < n; ++i) y[i] = g_next[i] - g[i];            // NOLINT
+      g.swap(g_next);
+      double sy = 0., yy = 0.;
+      for (long i = 0; i < n; ++i) {                                   // NOLINT
+        sy += s[i]*y[i];
+        yy += y[i]*y[i];
+      }
+      // Pairs without positive curvature are skipped.
+      if (sy > std::numeric_limits<double>::epsilon()*yy) {
+        s_history.push_back(s);
+        y_history.push_back(y);
+        rho_history.push_back(1./sy);
+        if (static_cast<long>(s_history.size()) > memory_) {           // NOLINT
+          s_history.pop_front();
+          y_history.pop_front();
+          rho_history.pop_front();
+        }
+      }
+    }  // end of descent
+    if (is_verbose_)
+      printf("L-BFGS: best %g after %li evaluations, %li iterations, "
+             "stop %s\n", is_find_minimum_ ? best_cost_ : -best_cost_,
+             evaluations_, generations_, stop_reason_.c_str());
+    return kDone;
+  }  // end of int LBFGS::RunOptimization()
+}  // end of namespace jade
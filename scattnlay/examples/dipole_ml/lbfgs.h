@@ -0,0 +1,71 @@
+#ifndef SRC_LBFGS_H_
+#define SRC_LBFGS_H_
+///
+/// @file   lbfgs.h
+/// @brief  Bound-constrained limited-memory BFGS local search (Dong C.
+/// Liu and Jorge Nocedal, Math. Programming 45, 1989) with the
+/// gradient projection of L-BFGS-B and gradients by central
+/// differences, evaluated as one batch.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <string>
+#include <vector>
+#include "./optimizer.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Projected L-BFGS descent from a single point. The search
+  /// runs in coordinates scaled to [0, 1] by the bounds. Coordinates at
+  /// a bound with the gradient pointing outwards are fixed for the
+  /// step, the two-loop recursion acts on the free ones, and a
+  /// backtracking line search along the projected path evaluates
+  /// several step lengths as one batch. The gradient costs
+  /// 2*dimension evaluations, one-sided at the bounds.
+  class LBFGS : public Optimizer {
+   public:
+    /// @brief Start point, a random one if empty (default).
+    void SetStart(std::vector<double> x) {start_ = x;}
+    /// @brief Correction pairs kept, 8 by default.
+    int SetMemory(long pairs);                                         // NOLINT
+    /// @brief Difference step in scaled coordinates, 6e-6 (cube root
+    /// of the machine epsilon) by default.
+    int SetStep(double step);
+    /// @brief Step lengths tried in one batch of the line search, each
+    /// half of the previous one, 4 by default.
+    int SetLinePoints(long points);                                    // NOLINT
+    /// @brief The descent stops when the largest projected gradient
+    /// component (scaled coordinates) is below tol_grad*max(|f|, 1), or
+    /// a step improves the fitness by less than tol_fun*max(|f|, 1).
+    int SetTolerances(double tol_grad, double tol_fun);
+    /// @brief Descend until a tolerance is met, the line search fails
+    /// or the budget is spent.
+    int RunOptimization() override;
+    /// @brief Why the last descent stopped.
+    std::string GetStopReason() {return stop_reason_;}
+
+   private:
+    void ToPheno(const double *u, double *x);
+    /// @brief Gradient of the cost at u, false if the budget does not
+    /// allow it.
+    bool Gradient(const std::vector<double> &u, std::vector<double> *g);
+    std::vector<double> start_;
+    long memory_ = 8, line_points_ = 4;                                // NOLINT
+    double step_ = 6e-6, tol_grad_ = 1e-10, tol_fun_ = 1e-14;
+    std::string stop_reason_;
+  };  // end of class LBFGS
+}  // end of namespace jade
+#endif  // SRC_LBFGS_H_
@@ -21,6 +21,7 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 #include "./matrix.h"
 #include "./sphereml.h"
 #include "./directivity.h"
+#include "./scan.h"
 
 #include <math.h>
 #include <cmath>
@@ -49,10 +50,13 @@ int main(int argc, char* argv[]) {
     for (int i=0; i<NL; ++i) {eL[i] = 2.*(2.+i) + 0.*j_;} eL[NL] = 1.;
     RL[0] = 0.09; for (int i=1; i<NL; ++i) {RL[i] = RL[i-1] + 0.02;}
     double dRd = 0.001*M_SQRT2;
-    for (int i = 0; i < 200; ++i) {
-        double Rd = dRd*i;     // dipole position
-        std::cout<<Rd<<" "<<evaluate_directivity(RL, eL, Rd, wl, px, py, pz)<<std::endl;
-    }
+        // adaptive samples of the former range of 200 uniform positions (Rd = 0 excluded):
+        // dense near the resonances and the interfaces, sparse elsewhere
+    std::vector<ScanPoint> peaks;
+    const auto& samples = scan_directivity_rd(RL, eL, wl, px, py, pz, dRd, 199*dRd, &peaks);
+    for (const auto &s : samples) std::cout<<s.t<<" "<<s.f<<std::endl;
+    std::cout.precision(10);
+    for (const auto &s : peaks) std::cout<<"# peak "<<s.t<<" "<<s.f<<std::endl;
     return 0;
 }
 
@@ -23,6 +23,9 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 
 #include "./matrix.h"
 #include <memory.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 const double nz_ = 1.e-15;
 
@@ -0,0 +1,152 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "nearfield.h"
+#include "farfield.h"
+#include "spfunc.h"
+
+#include <algorithm>
+
+     // work arrays of one thread; radial factors are kept for the last (region, radius)
+     // and Legendre tables for the last polar angle
+struct FieldWork {
+     int q; double r, t;
+     std::vector<Complex> J, Jd, H, Hd, fj, fjr, fjt, fh, fhr, fht;
+     std::vector<double> tp, tt, tP, cn, dn;
+     std::vector<Complex> te;
+
+     FieldWork(int N, int mmax) : q(-1), r(-1.), t(-1.),
+          J(N), Jd(N), H(N), Hd(N), fj(N), fjr(N), fjt(N), fh(N), fhr(N), fht(N),
+          tp((mmax+1)*N), tt((mmax+1)*N), tP((mmax+1)*N), cn(N), dn(N), te(2*mmax+1) {
+               for (int n=1; n<N; ++n) {dn[n] = sqrt(n*(n+1.)); cn[n] = M_SQRT1_2PI/dn[n]; dn[n] *= M_SQRT1_2PI;}
+     }
+};
+
+     // radial factors z_n, z_n/z and z_n/z + z_n' of the regular and outgoing waves
+static void radial_factors(const FieldExpansion &FE, int q, double r, bool reg, bool out, FieldWork &W) {
+     int n, N = FE.N;
+     Complex z = FE.k[q]*r;
+     if (abs(z) < 1.e-12) z = 1.e-12; // the regular fields are finite at the origin
+     if (reg) {
+          besj_array(z, N, W.J.data(), W.Jd.data());
+          for (n=0; n<N; ++n) {W.fj[n] = W.J[n]; W.fjr[n] = W.J[n]/z; W.fjt[n] = W.fjr[n] + W.Jd[n];}
+     }
+     else for (n=0; n<N; ++n) W.fj[n] = W.fjr[n] = W.fjt[n] = 0.;
+     if (out) {
+          besh1_array(z, N, W.H.data(), W.Hd.data());
+          for (n=0; n<N; ++n) {W.fh[n] = W.H[n]; W.fhr[n] = W.H[n]/z; W.fht[n] = W.fhr[n] + W.Hd[n];}
+     }
+     else for (n=0; n<N; ++n) W.fh[n] = W.fhr[n] = W.fht[n] = 0.;
+}
+
+     // spherical components of sum_nm a(nm)*M_nm + a(NN+nm)*N_nm for the coefficients ca
+     // (regular) and cb (outgoing) with the azimuthal factors W.te[m+mmax]; with curl == true
+     // G receives curl E/k, which has the M and N halves of the coefficients exchanged
+template <bool curl>
+static void sum_waves(const Complex *ca, const Complex *cb, int N, int mmax,
+                      const FieldWork &W, Complex *F, Complex *G) {
+     int n, m, am, nm, NN = N*N;
+     double sg, pn, tn, Pn;
+     Complex ae, ah, be, bh, Me, Nr, Nt, tf[3], tg[3];
+     F[0] = F[1] = F[2] = G[0] = G[1] = G[2] = 0.;
+     for (m=-mmax; m<mmax+1; ++m) {
+          am = abs(m); sg = (m < 0 && am%2) ? -1. : 1.;
+          tf[0] = tf[1] = tf[2] = tg[0] = tg[1] = tg[2] = 0.;
+          for (n=std::max(am,1); n<N; ++n) {
+               nm = n*(n+1)+m;
+               ae = ca[nm]; ah = ca[NN+nm]; be = cb[nm]; bh = cb[NN+nm];
+                    // P_n^-m = (-1)^m P_n^m, pi_n^-m = -(-1)^m pi_n^m, tau_n^-m = (-1)^m tau_n^m
+               Pn = sg*W.tP[am*N+n]; tn = sg*W.tt[am*N+n]; pn = (m < 0) ? -sg*W.tp[am*N+n] : W.tp[am*N+n];
+               Me = ae*W.fj[n] + be*W.fh[n]; Nr = ah*W.fjr[n] + bh*W.fhr[n]; Nt = ah*W.fjt[n] + bh*W.fht[n];
+               tf[0] += W.dn[n]*Pn*Nr;
+               tf[1] += W.cn[n]*(j_*pn*Me + tn*Nt);
+               tf[2] += W.cn[n]*(j_*pn*Nt - tn*Me);
+               if (curl) {
+                    Me = ah*W.fj[n] + bh*W.fh[n]; Nr = ae*W.fjr[n] + be*W.fhr[n]; Nt = ae*W.fjt[n] + be*W.fht[n];
+                    tg[0] += W.dn[n]*Pn*Nr;
+                    tg[1] += W.cn[n]*(j_*pn*Me + tn*Nt);
+                    tg[2] += W.cn[n]*(j_*pn*Nt - tn*Me);
+               }
+          }
+          for (n=0; n<3; ++n) {F[n] += tf[n]*W.te[m+mmax]; if (curl) G[n] += tg[n]*W.te[m+mmax];}
+     }
+}
+
+static void to_cartesian(const Complex *F, double t, double ph, Complex *V) {
+     double st = sin(t), ct = cos(t), sp = sin(ph), cp = cos(ph);
+     V[0] = F[0]*st*cp + F[1]*ct*cp - F[2]*sp;
+     V[1] = F[0]*st*sp + F[1]*ct*sp + F[2]*cp;
+     V[2] = F[0]*ct - F[1]*st;
+}
+
+void evaluate_fields(const FieldExpansion &FE, const double *xyz, long np, Complex *E, Complex *H) {
+     int q, NQ = FE.k.size(), N = FE.N, mmax = 0;
+     std::vector<double> rr(np), tt(np), pp(np);
+     std::vector<int> qq(np);
+     std::vector<long> order(np);
+     std::vector<char> reg(NQ), out(NQ);
+
+     for (q=0; q<NQ; ++q) {
+          mmax = std::max(mmax, std::max(FarField::max_order(FE.A[q],N), FarField::max_order(FE.B[q],N)));
+          reg[q] = FE.A[q].normF() > 0.; out[q] = FE.B[q].normF() > 0.;
+     }
+     for (long i=0; i<np; ++i) {
+          const double *x = xyz + 3*i, rho = sqrt(x[0]*x[0] + x[1]*x[1]);
+          rr[i] = sqrt(rho*rho + x[2]*x[2]);
+          tt[i] = (rr[i] > 0.) ? acos(std::max(-1., std::min(1., x[2]/rr[i]))) : 0.;
+          pp[i] = atan2(x[1], x[0]);
+          qq[i] = std::upper_bound(FE.R.begin(), FE.R.end(), rr[i]) - FE.R.begin();
+          order[i] = i;
+     }
+          // consecutive points share the radial factors and the Legendre tables
+     std::sort(order.begin(), order.end(), [&](long a, long b) {
+          if (qq[a] != qq[b]) return qq[a] < qq[b];
+          if (rr[a] != rr[b]) return rr[a] < rr[b];
+          return tt[a] < tt[b];
+     });
+
+#pragma omp parallel
+     {
+          FieldWork W(N, mmax);
+          Complex F[3], G[3];
+#pragma omp for schedule(dynamic,256)
+          for (long ip=0; ip<np; ++ip) {
+               const long i = order[ip];
+               const int q = qq[i];
+               if (q != W.q || rr[i] != W.r) {
+                    radial_factors(FE, q, rr[i], reg[q], out[q], W);
+                    W.q = q; W.r = rr[i];
+               }
+               if (tt[i] != W.t) {
+                    for (int m=0; m<mmax+1; ++m)
+                         legendre_pitau(tt[i], N, m, &W.tP[m*N], &W.tp[m*N], &W.tt[m*N]);
+                    W.t = tt[i];
+               }
+               for (int m=-mmax; m<mmax+1; ++m) W.te[m+mmax] = exp(j_*(m*pp[i]));
+               if (H) sum_waves<true>(FE.A[q].Data, FE.B[q].Data, N, mmax, W, F, G);
+               else sum_waves<false>(FE.A[q].Data, FE.B[q].Data, N, mmax, W, F, G);
+               to_cartesian(F, tt[i], pp[i], E + 3*i);
+               if (H) {
+                         // curl E = i k0 Z0 H with curl M = k N and curl N = k M
+                    for (int k=0; k<3; ++k) G[k] *= -j_*FE.ri[q];
+                    to_cartesian(G, tt[i], pp[i], H + 3*i);
+               }
+          }
+     }
+}
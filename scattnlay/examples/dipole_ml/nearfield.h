@@ -0,0 +1,45 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef _NEARFIELD_H
+#define _NEARFIELD_H
+
+#include "matrix.h"
+
+#include <vector>
+
+     // Field expanded over concentric regions: region q covers R[q-1] <= r < R[q] (R has one
+     // element less than the regions, the last region is unbounded) and holds
+     // E = sum_nm A[q](nm)*RgM_nm + A[q](NN+nm)*RgN_nm + B[q](nm)*M1_nm + B[q](NN+nm)*N1_nm
+     // with the vector wave functions of spfunc (svfRgM, svfN1, ...) at the wavenumber k[q]
+     // and the harmonic order of calc_edz and calc_pw.
+struct FieldExpansion {
+     int N;
+     std::vector<double> R;
+     std::vector<Complex> k;  // wavenumber in each region
+     std::vector<Complex> ri; // refractive index in each region (k/k0)
+     std::vector<Vector> A, B;
+};
+
+     // E and Z0*H (may be null) in Cartesian components at np points xyz[3*i..3*i+2];
+     // points are grouped by region, radius and polar angle so that Bessel arrays and
+     // Legendre tables are shared, and split over OpenMP threads
+void evaluate_fields(const FieldExpansion &FE, const double *xyz, long np, Complex *E, Complex *H);
+
+#endif
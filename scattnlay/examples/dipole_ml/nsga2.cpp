@@ -0,0 +1,300 @@
+///
+/// @file   nsga2.cpp
+/// @brief  Multi-objective NSGA-II.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./nsga2.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include "./genetic.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::SetObjectives(const std::vector<bool> &is_maximized) {
+    if (is_maximized.empty())
+      throw std::invalid_argument("There should be at least one objective!");
+    is_maximized_ = is_maximized;
+    return kDone;
+  }  // end of int NSGA2::SetObjectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::SetPopulation(long popsize) {                             // NOLINT
+    if (popsize < 2)
+      throw std::invalid_argument("Population should be at least 2!");
+    popsize_ = popsize;
+    return kDone;
+  }  // end of int NSGA2::SetPopulation(long popsize)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::SetGenerations(long generations) {                        // NOLINT
+    if (generations < 0)
+      throw std::invalid_argument("Number of generations should be >= 0!");
+    generations_limit_ = generations;
+    return kDone;
+  }  // end of int NSGA2::SetGenerations(long generations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::SetCrossover(double probability, double eta) {
+    if (!(probability >= 0 && probability <= 1) || !(eta >= 0))
+      throw std::invalid_argument(
+          "Crossover probability should be in [0, 1], eta >= 0!");
+    crossover_probability_ = probability;
+    crossover_eta_ = eta;
+    return kDone;
+  }  // end of int NSGA2::SetCrossover(double probability, double eta)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::SetMutation(double probability, double eta) {
+    if (!(probability >= 0 && probability <= 1) || !(eta >= 0))
+      throw std::invalid_argument(
+          "Mutation probability should be in [0, 1], eta >= 0!");
+    mutation_probability_ = probability;
+    mutation_eta_ = eta;
+    return kDone;
+  }  // end of int NSGA2::SetMutation(double probability, double eta)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void NSGA2::EvaluateObjectives(const std::vector<double> &x,
+                                 std::vector<double> *cost) {
+    const long size = x.size()/dimension_, m = is_maximized_.size();  // NOLINT
+    cost->resize(size*m);
+    evaluations_ += size;
+    if (BatchObjectivesFunction) {
+      BatchObjectivesFunction(&x.front(), size, dimension_, &cost->front());
+    } else {
+#pragma omp parallel for schedule(dynamic) if (is_parallel_evaluation_)
+      for (long i = 0; i < size; ++i)                                  // NOLINT
+        ObjectivesFunction(&x[i*dimension_], dimension_, &(*cost)[i*m]);
+    }
+    for (long i = 0; i < size; ++i) {                                  // NOLINT
+      for (long k = 0; k < m; ++k) {                                   // NOLINT
+        double &f = (*cost)[i*m + k];
+        if (std::isnan(f)) f = std::numeric_limits<double>::infinity();
+        else if (is_maximized_[k]) f = -f;
+      }
+      if ((*cost)[i*m] < best_cost_ || best_x_.empty()) {
+        best_cost_ = (*cost)[i*m];
+        best_x_.assign(&x[i*dimension_], &x[i*dimension_] + dimension_);
+      }
+    }
+  }  // end of void NSGA2::EvaluateObjectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void NSGA2::Sort(const std::vector<double> &cost,
+                   std::vector<long> *front) {                         // NOLINT
+    const long m = is_maximized_.size(), size = cost.size()/m;         // NOLINT
+    // Fast non-dominated sort: dominated[p] lists the individuals p
+    // dominates, count[p] is the number of individuals dominating p.
+    std::vector<std::vector<long> > dominated(size);                   // NOLINT
+    std::vector<long> count(size, 0), current, next;                   // NOLINT
+    for (long p = 0; p < size; ++p) {                                  // NOLINT
+      for (long q = p + 1; q < size; ++q) {                            // NOLINT
+        bool is_p_better = false, is_q_better = false;
+        for (long k = 0; k < m; ++k) {                                 // NOLINT
+          if (cost[p*m + k] < cost[q*m + k]) is_p_better = true;
+          else if (cost[q*m + k] < cost[p*m + k]) is_q_better = true;
+        }
+        if (is_p_better && !is_q_better) {
+          dominated[p].push_back(q);
+          ++count[q];
+        } else if (is_q_better && !is_p_better) {
+          dominated[q].push_back(p);
+          ++count[p];
+        }
+      }
+    }  // end of for each pair
+    front->assign(size, 0);
+    for (long p = 0; p < size; ++p) if (count[p] == 0) current.push_back(p);  // NOLINT
+    for (long rank = 0; !current.empty(); ++rank) {                    // NOLINT
+      next.clear();
+      for (auto p : current) {
+        (*front)[p] = rank;
+        for (auto q : dominated[p]) if (--count[q] == 0) next.push_back(q);
+      }
+      current.swap(next);
+    }
+  }  // end of void NSGA2::Sort()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void NSGA2::Crowding(const std::vector<double> &cost,
+                       const std::vector<long> &front,                 // NOLINT
+                       std::vector<double> *distance) {
+    const long m = is_maximized_.size(), size = front.size();          // NOLINT
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    distance->assign(size, 0.);
+    const long fronts = *std::max_element(front.begin(), front.end()) + 1;  // NOLINT
+    std::vector<std::vector<long> > members(fronts);                   // NOLINT
+    for (long p = 0; p < size; ++p) members[front[p]].push_back(p);    // NOLINT
+    for (auto &f : members) {
+      for (long k = 0; k < m; ++k) {                                   // NOLINT
+        std::stable_sort(f.begin(), f.end(), [&](long a, long b) {     // NOLINT
+            return cost[a*m + k] < cost[b*m + k];
+          });
+        (*distance)[f.front()] = kInfinity;
+        (*distance)[f.back()] = kInfinity;
+        // Infinite (NaN) objectives span no range.
+        const double range = cost[f.back()*m + k] - cost[f.front()*m + k];
+        if (!(range > 0) || std::isinf(range)) continue;
+        for (unsigned long i = 1; i + 1 < f.size(); ++i)               // NOLINT
+          (*distance)[f[i]] += (cost[f[i + 1]*m + k] - cost[f[i - 1]*m + k])
+              /range;
+      }
+    }  // end of for each front
+  }  // end of void NSGA2::Crowding()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void NSGA2::Mutate(double *x) {
+    const double power = 1./(mutation_eta_ + 1.);
+    const double probability = mutation_probability_ > 0
+      ? mutation_probability_ : 1./static_cast<double>(dimension_);
+    for (long i = 0; i < dimension_; ++i) {                            // NOLINT
+      if (stream_.Uniform() > probability) continue;
+      const double xl = lbound_[i], xu = ubound_[i];
+      const double delta_1 = (x[i] - xl)/(xu - xl);
+      const double delta_2 = (xu - x[i])/(xu - xl);
+      const double rand = stream_.Uniform();
+      double delta_q;
+      if (rand < 0.5) {
+        const double value = 2.*rand + (1. - 2.*rand)
+          *std::pow(1. - delta_1, mutation_eta_ + 1.);
+        delta_q = std::pow(value, power) - 1.;
+      } else {
+        const double value = 2.*(1. - rand) + 2.*(rand - 0.5)
+          *std::pow(1. - delta_2, mutation_eta_ + 1.);
+        delta_q = 1. - std::pow(value, power);
+      }
+      x[i] = std::min(std::max(x[i] + delta_q*(xu - xl), xl), xu);
+    }  // end of for each coordinate
+  }  // end of void NSGA2::Mutate(double *x)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int NSGA2::RunOptimization() {
+    if (evaluation_budget_ == 0 && generations_limit_ == 0)
+      throw std::invalid_argument(
+          "Set an evaluation budget or a number of generations!");
+    StartRun();
+    is_find_minimum_ = !is_maximized_.front();
+    population_.clear();
+    population_cost_.clear();
+    population_front_.clear();
+    const long n = dimension_, size = popsize_;                        // NOLINT
+    const long m = is_maximized_.size();                               // NOLINT
+    if (!IsBudgetLeft(size)) return kDone;
+    std::vector<double> pop(size*n), cost, distance;
+    std::vector<long> front;                                           // NOLINT
+    for (long p = 0; p < size; ++p)                                    // NOLINT
+      for (long i = 0; i < n; ++i)                                     // NOLINT
+        pop[p*n + i] = stream_.rand(lbound_[i], ubound_[i]);
+    EvaluateObjectives(pop, &cost);
+    Sort(cost, &front);
+    Crowding(cost, front, &distance);
+    // Offspring of an odd population has a spare child.
+    std::vector<double> offspring, offspring_cost, merged, merged_cost;
+    std::vector<double> merged_distance;
+    std::vector<long> merged_front, order(2*size);                     // NOLINT
+    auto tournament = [&]() {
+      const long a = stream_.randint(0, size - 1);                     // NOLINT
+      const long b = stream_.randint(0, size - 1);                     // NOLINT
+      if (front[a] != front[b]) return front[a] < front[b] ? a : b;
+      return distance[b] > distance[a] ? b : a;
+    };
+    while ((generations_limit_ == 0 || generations_ < generations_limit_)
+           && IsBudgetLeft(size)) {
+      offspring.resize((size + (size & 1))*n);
+      for (long q = 0; q < size; q += 2) {                             // NOLINT
+        double *x1 = &offspring[q*n], *x2 = &offspring[(q + 1)*n];
+        const long p1 = tournament(), p2 = tournament();               // NOLINT
+        std::copy(&pop[p1*n], &pop[p1*n] + n, x1);
+        std::copy(&pop[p2*n], &pop[p2*n] + n, x2);
+        if (stream_.Uniform() < crossover_probability_)
+          SimulatedBinaryCrossover(lbound_, ubound_, crossover_eta_,
+                                   &stream_, x1, x2);
+        Mutate(x1);
+        Mutate(x2);
+      }
+      offspring.resize(size*n);
+      EvaluateObjectives(offspring, &offspring_cost);
+      // Environmental selection from parents and offspring.
+      merged = pop;
+      merged.insert(merged.end(), offspring.begin(), offspring.end());
+      merged_cost = cost;
+      merged_cost.insert(merged_cost.end(), offspring_cost.begin(),
+                         offspring_cost.end());
+      Sort(merged_cost, &merged_front);
+      Crowding(merged_cost, merged_front, &merged_distance);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](long a, long b) {  // NOLINT
+          if (merged_front[a] != merged_front[b])
+            return merged_front[a] < merged_front[b];
+          return merged_distance[a] > merged_distance[b];
+        });
+      for (long p = 0; p < size; ++p) {                                // NOLINT
+        const long s = order[p];                                       // NOLINT
+        std::copy(&merged[s*n], &merged[s*n] + n, &pop[p*n]);
+        std::copy(&merged_cost[s*m], &merged_cost[s*m] + m, &cost[p*m]);
+        front[p] = merged_front[s];
+        distance[p] = merged_distance[s];
+      }
+      ++generations_;
+    }  // end of generations
+    population_.swap(pop);
+    population_cost_.swap(cost);
+    population_front_.swap(front);
+    if (is_verbose_)
+      printf("NSGA-II: front of %li after %li evaluations, %li generations\n",
+             static_cast<long>(std::count(population_front_.begin(),  // NOLINT
+                                          population_front_.end(), 0)),
+             evaluations_, generations_);
+    return kDone;
+  }  // end of int NSGA2::RunOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<std::vector<double> > NSGA2::GetFront(
+      std::vector<std::vector<double> > *objectives) {
+    const long n = dimension_, m = is_maximized_.size();               // NOLINT
+    std::vector<long> members;                                         // NOLINT
+    for (unsigned long p = 0; p < population_front_.size(); ++p)       // NOLINT
+      if (population_front_[p] == 0) members.push_back(p);
+    std::stable_sort(members.begin(), members.end(), [&](long a, long b) {  // NOLINT
+        return population_cost_[a*m] < population_cost_[b*m];
+      });
+    std::vector<std::vector<double> > front;
+    objectives->clear();
+    for (auto p : members) {
+      front.emplace_back(&population_[p*n], &population_[p*n] + n);
+      std::vector<double> f(&population_cost_[p*m],
+                            &population_cost_[p*m] + m);
+      for (long k = 0; k < m; ++k) if (is_maximized_[k]) f[k] = -f[k];  // NOLINT
+      objectives->push_back(f);
+    }
+    return front;
+  }  // end of std::vector<std::vector<double> > NSGA2::GetFront()
+}  // end of namespace jade
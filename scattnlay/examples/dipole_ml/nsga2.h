@@ -0,0 +1,97 @@
+#ifndef SRC_NSGA2_H_
+#define SRC_NSGA2_H_
+///
+/// @file   nsga2.h
+/// @brief  Multi-objective NSGA-II (Kalyanmoy Deb et al., IEEE Trans.
+/// Evol. Comput. 6, 2002) with bounded simulated binary crossover and
+/// polynomial mutation, the offspring of a generation is evaluated as
+/// one batch.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <functional>
+#include <vector>
+#include "./optimizer.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Elitist non-dominated sorting GA: parents and offspring are
+  /// merged, sorted into fronts of non-dominated individuals and the
+  /// next population is filled front by front, the last front that
+  /// does not fit is cut by the crowding distance. Parents are picked
+  /// by binary tournaments on (front, crowding distance). The result is
+  /// the first front of the final population, GetBest() gives the best
+  /// vector found in the first objective.
+  class NSGA2 : public Optimizer {
+   public:
+    /// @brief Objectives of x[0..dimension-1], written to
+    /// objectives[0..count-1]; NaN makes an objective the worst.
+    std::function<void(const double *x, long dimension,               // NOLINT
+                       double *objectives)> ObjectivesFunction;
+    /// @brief Optional objectives of a whole batch of size vectors
+    /// (rows of x), row by row, used instead of ObjectivesFunction.
+    std::function<void(const double *x, long size, long dimension,    // NOLINT
+                       double *objectives)> BatchObjectivesFunction;
+    /// @brief Number of objectives and their directions, all of them
+    /// are minimized unless is_maximized says otherwise. Two objectives
+    /// (both minimized) by default.
+    int SetObjectives(const std::vector<bool> &is_maximized);
+    /// @brief 100 by default.
+    int SetPopulation(long popsize);                                   // NOLINT
+    /// @brief Offspring generations, 250 by default, 0 - run until the
+    /// evaluation budget is spent.
+    int SetGenerations(long generations);                              // NOLINT
+    /// @brief Probability of a pair to be mated (.9) and the
+    /// distribution index of the crossover (20).
+    int SetCrossover(double probability, double eta);
+    /// @brief Probability of a coordinate to be mutated, 0 (default)
+    /// - 1/dimension, and the distribution index of the mutation (20).
+    int SetMutation(double probability, double eta);
+    int RunOptimization() override;
+    /// @brief Non-dominated vectors of the last run ordered by the
+    /// first objective, their objectives go to the rows of objectives.
+    std::vector<std::vector<double> > GetFront(
+        std::vector<std::vector<double> > *objectives);
+
+   protected:
+    bool IsFitnessSet() override {
+      return ObjectivesFunction || BatchObjectivesFunction;
+    }
+
+   private:
+    /// @brief Objectives of the rows of x as minimized costs, row by
+    /// row; the best record follows the first objective.
+    void EvaluateObjectives(const std::vector<double> &x,
+                            std::vector<double> *cost);
+    /// @brief Fronts of the rows of cost: front[p] is 0 for the
+    /// non-dominated ones, 1 for the ones dominated only by them, ...
+    void Sort(const std::vector<double> &cost, std::vector<long> *front);  // NOLINT
+    /// @brief Crowding distance of the members of each front.
+    void Crowding(const std::vector<double> &cost,
+                  const std::vector<long> &front,                      // NOLINT
+                  std::vector<double> *distance);
+    /// @brief Polynomial mutation (DEAP mutPolynomialBounded).
+    void Mutate(double *x);
+    std::vector<bool> is_maximized_ = {false, false};
+    long popsize_ = 100, generations_limit_ = 250;                     // NOLINT
+    double crossover_probability_ = .9, crossover_eta_ = 20.;
+    double mutation_probability_ = 0., mutation_eta_ = 20.;
+    /// @brief Population of the last run with its costs and fronts.
+    std::vector<double> population_, population_cost_;
+    std::vector<long> population_front_;                               // NOLINT
+  };  // end of class NSGA2
+}  // end of namespace jade
+#endif  // SRC_NSGA2_H_
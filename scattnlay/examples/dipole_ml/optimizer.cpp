@@ -0,0 +1,123 @@
+///
+/// @file   optimizer.cpp
+/// @brief  Common part of the single-process engines of JADE++.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./optimizer.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Optimizer::Init(long dimension) {                                // NOLINT
+    if (dimension < 1)
+      throw std::invalid_argument("Dimension should be at least 1!");
+    dimension_ = dimension;
+    lbound_.clear();
+    ubound_.clear();
+    std::random_device rd;
+    SetSeed((static_cast<unsigned long>(rd()) << 32) ^ rd());          // NOLINT
+    return kDone;
+  }  // end of int Optimizer::Init(long dimension)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Optimizer::SetSeed(unsigned long seed) {                        // NOLINT
+    seed_ = seed;
+    run_ = 0;
+  }  // end of void Optimizer::SetSeed(unsigned long seed)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Optimizer::SetAllBoundsVectors(std::vector<double> lbound,
+                                      std::vector<double> ubound) {
+    lbound_ = lbound;
+    ubound_ = ubound;
+  }  // end of void Optimizer::SetAllBoundsVectors()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Optimizer::SetAllBounds(double lbound, double ubound) {
+    if (lbound >= ubound)
+      throw std::invalid_argument("Wrong bounds!");
+    lbound_.assign(dimension_, lbound);
+    ubound_.assign(dimension_, ubound);
+    return kDone;
+  }  // end of int Optimizer::SetAllBounds(double lbound, double ubound)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Optimizer::SetEvaluationBudget(long evaluations) {               // NOLINT
+    if (evaluations < 0)
+      throw std::invalid_argument("Evaluation budget should be >= 0!");
+    evaluation_budget_ = evaluations;
+    return kDone;
+  }  // end of int Optimizer::SetEvaluationBudget(long evaluations)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Optimizer::StartRun() {
+    if (!IsFitnessSet())
+      throw std::invalid_argument("You should set fitness function!");
+    if (static_cast<long>(lbound_.size()) != dimension_                // NOLINT
+        || static_cast<long>(ubound_.size()) != dimension_)            // NOLINT
+      throw std::invalid_argument("Bounds should be set for all coordinates!");
+    for (long c = 0; c < dimension_; ++c)                              // NOLINT
+      if (!(lbound_[c] < ubound_[c]) || std::isinf(ubound_[c] - lbound_[c]))
+        throw std::invalid_argument("Bounds should be finite and ordered!");
+    stream_ = RandomStream(seed_, 0, ++run_, 0);
+    evaluations_ = 0;
+    generations_ = 0;
+    best_x_.clear();
+    best_cost_ = std::numeric_limits<double>::infinity();
+  }  // end of void Optimizer::StartRun()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int Optimizer::EvaluateBatch(const std::vector<double> &x,
+                               std::vector<double> *cost) {
+    const long size = x.size()/dimension_;                             // NOLINT
+    cost->resize(size);
+    evaluations_ += size;
+    if (BatchFitnessFunction) {
+      BatchFitnessFunction(&x.front(), size, dimension_, &cost->front());
+    } else {
+#pragma omp parallel for schedule(dynamic) if (is_parallel_evaluation_)
+      for (long i = 0; i < size; ++i)                                  // NOLINT
+        (*cost)[i] = FitnessFunction(&x[i*dimension_], dimension_);
+    }
+    for (long i = 0; i < size; ++i) {                                  // NOLINT
+      double &f = (*cost)[i];
+      if (std::isnan(f)) f = std::numeric_limits<double>::infinity();
+      else if (!is_find_minimum_) f = -f;
+      if (f < best_cost_ || best_x_.empty()) {
+        best_cost_ = f;
+        best_x_.assign(&x[i*dimension_], &x[i*dimension_] + dimension_);
+      }
+    }
+    return kDone;
+  }  // end of int Optimizer::EvaluateBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<double> Optimizer::GetBest(double *best_fitness) {
+    (*best_fitness) = is_find_minimum_ ? best_cost_ : -best_cost_;
+    return best_x_;
+  }  // end of std::vector<double> Optimizer::GetBest(double *best_fitness)
+}  // end of namespace jade
@@ -0,0 +1,92 @@
+#ifndef SRC_OPTIMIZER_H_
+#define SRC_OPTIMIZER_H_
+///
+/// @file   optimizer.h
+/// @brief  Common part of the single-process engines of JADE++ (CMA-ES,
+/// (1+1)-ES, genetic algorithm, NSGA-II): fitness interface, search box,
+/// random stream, evaluation budget and the best-so-far record.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <functional>
+#include <vector>
+#include "./jade.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  class Optimizer {
+   public:
+    /// @brief Same fitness interface as SubPopulation.
+    std::function<double(const double *x, long dimension)>             // NOLINT
+        FitnessFunction;
+    std::function<void(const double *x, long size, long dimension,     // NOLINT
+                       double *fitness)> BatchFitnessFunction;
+    virtual ~Optimizer() {}
+    /// @brief Class initialization with default settings.
+    virtual int Init(long dimension);                                  // NOLINT
+    /// @brief Make the run reproducible (call after Init).
+    void SetSeed(unsigned long seed);                                 // NOLINT
+    /// @brief Evaluate FitnessFunction in OpenMP threads (default),
+    /// results do not depend on the number of threads.
+    void SetParallelEvaluation(bool is_parallel) {
+      is_parallel_evaluation_ = is_parallel;
+    }
+    void SetVerbose(bool is_verbose) {is_verbose_ = is_verbose;}
+    void SetAllBoundsVectors(std::vector<double> lbound,
+                             std::vector<double> ubound);
+    int SetAllBounds(double lbound, double ubound);
+    void SetTargetToMinimum() {is_find_minimum_ = true;}
+    void SetTargetToMaximum() {is_find_minimum_ = false;}
+    /// @brief Stop before a batch would exceed `evaluations` fitness
+    /// evaluations in the run, 0 - no budget.
+    int SetEvaluationBudget(long evaluations);                         // NOLINT
+    /// @brief Optimize until the budget is spent or the engine stops.
+    virtual int RunOptimization() = 0;
+    std::vector<double> GetBest(double *best_fitness);
+    long GetEvaluations() {return evaluations_;}                       // NOLINT
+    long GetGenerations() {return generations_;}                       // NOLINT
+
+   protected:
+    /// @brief The engine has a fitness to evaluate.
+    virtual bool IsFitnessSet() {
+      return FitnessFunction || BatchFitnessFunction;
+    }
+    /// @brief Check the setup and reset the counters, the best record
+    /// and the random stream for a new run.
+    void StartRun();
+    /// @brief A batch of `size` evaluations fits into the budget.
+    bool IsBudgetLeft(long size) {                                     // NOLINT
+      return evaluation_budget_ == 0 || evaluations_ + size <= evaluation_budget_;
+    }
+    /// @brief Evaluate the rows of x and record the best of them.
+    /// Returned costs are minimized: fitness with the sign flipped for
+    /// maximization, NaN becomes +inf.
+    int EvaluateBatch(const std::vector<double> &x,
+                      std::vector<double> *cost);
+    long dimension_ = 0;                                               // NOLINT
+    std::vector<double> lbound_, ubound_;
+    bool is_find_minimum_ = true;
+    bool is_parallel_evaluation_ = true, is_verbose_ = false;
+    long evaluation_budget_ = 0;                                       // NOLINT
+    uint64_t seed_ = 0;
+    uint32_t run_ = 0;
+    RandomStream stream_;
+    long evaluations_ = 0, generations_ = 0;                           // NOLINT
+    std::vector<double> best_x_;
+    double best_cost_ = 0;
+  };  // end of class Optimizer
+}  // end of namespace jade
+#endif  // SRC_OPTIMIZER_H_
@@ -0,0 +1,736 @@
+///
+/// @file   pybind_jadepp.cpp
+/// @brief  Python module pyjade: JADE++ optimization of the dipole in
+/// a multilayer sphere with native objectives, a replacement of
+/// pyfde.JADE with fitness2() of optimize.py.
+///
+/// The whole run stays in C++ with the GIL released, fitness is
+/// evaluated in OpenMP threads. A named objective is configured by a
+/// dict of parameters:
+///
+///   import pyjade
+///   limits = [(wl*1e-3, wl*2)] + [(0, wl*max_ratio)]*NL + [(1, 30)]*NL
+///   solver = pyjade.JADE("directivity_on_axis", limits, population=75,
+///                        params={"NL": NL, "wl": wl, "N": 50})
+///   best, fit = solver.run(20)   # continues the run on the next call
+///
+/// Objectives take x = [Rd, R1..RNL, n1..nNL] as fitness2(), radii are
+/// sorted and the design made canonical (see canonical_design), a
+/// dipole on an interface gives 0 as well as NaN values.
+/// Parameters (defaults): NL 3, N 50, wl 0.455, px 1, py 0, pz 0,
+/// th 0, ph 0, host_index 1, th_cone pi/6, th_main pi/6.
+///
+/// Test functions f1..f13 of functions.py are native objectives too,
+/// minimized with maximize=False, their bounds are given by
+/// pyjade.test_bounds(name).
+///
+/// A Python callable f(x) -> float can be given instead of the name,
+/// it is called from the optimizer thread with the GIL held; with
+/// vectorized=True it gets all trial vectors of a generation as rows
+/// of a 2D array and returns an array of fitness values.
+///
+/// pyjade.CMAES takes the same objectives and runs CMA-ES with IPOP or
+/// BIPOP restarts up to an evaluation budget in one run() call.
+/// pyjade.OnePlusOne and pyjade.Genetic replace one_plus_one() and
+/// genetic() of algorithms/genetic.py with the same parameters.
+/// JADE.set_polishing() makes a hybrid of JADE and L-BFGS descents
+/// from the best individuals, JADE.set_surrogate() pre-screens trial
+/// vectors by a Gaussian-process model.
+///
+/// pyjade.NSGA2 returns the whole trade-off front of several
+/// objectives in one run: the native "emission" (directivity, radiated
+/// power relative to the dipole in the host medium, outer radius/wl)
+/// or a callable f(x) -> sequence of objectives.
+///
+/// pyjade.open_store(file) memoizes the native objectives in a file
+/// shared by processes, see evalstore.h.
+///
+/// MPI is initialized on the first use of JADE if it was not (e.g. by
+/// mpi4py) and finalized at exit then; every optimizer works on
+/// MPI_COMM_SELF.
+#include <mpi.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "./jade.h"
+#include "./cmaes.h"
+#include "./genetic.h"
+#include "./nsga2.h"
+#include "./testfunctions.h"
+#include "./directivity.h"
+#include "./evalstore.h"
+
+namespace py = pybind11;
+namespace {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  struct ObjectiveParameters {
+    int NL = 3, N = 50;
+    double wl = 0.455, px = 1., py = 0., pz = 0., th = 0., ph = 0.;
+    double host_index = 1., th_cone = M_PI/6., th_main = M_PI/6.;
+  };
+  typedef std::function<double(const ObjectiveParameters &p,
+                               const std::vector<double> &RL,
+                               const std::vector< std::complex<double> > &eL,
+                               double Rd)> Objective;
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Registry of native objectives, all of them are maximized by
+  /// default.
+  const std::map<std::string, Objective> &Objectives() {
+    static const std::map<std::string, Objective> objectives = {
+      {"directivity_on_axis", [](const ObjectiveParameters &p,
+                                 const std::vector<double> &RL,
+                                 const std::vector< std::complex<double> > &eL,
+                                 double Rd) {
+         return evaluate_directivity(RL, eL, Rd, p.wl, p.px, p.py, p.pz,
+                                     0., 0., p.N);
+       }},
+      {"directivity", [](const ObjectiveParameters &p,
+                         const std::vector<double> &RL,
+                         const std::vector< std::complex<double> > &eL,
+                         double Rd) {
+         return evaluate_directivity(RL, eL, Rd, p.wl, p.px, p.py, p.pz,
+                                     p.th, p.ph, p.N);
+       }},
+      // Share of the radiated power in the sector th < th_cone.
+      {"directivity_sector", [](const ObjectiveParameters &p,
+                                const std::vector<double> &RL,
+                                const std::vector< std::complex<double> > &eL,
+                                double Rd) {
+         return evaluate_cone_efficiency(RL, eL, Rd, p.wl, p.px, p.py, p.pz,
+                                         p.th_cone, p.N);
+       }},
+      {"side_lobe_ratio", [](const ObjectiveParameters &p,
+                             const std::vector<double> &RL,
+                             const std::vector< std::complex<double> > &eL,
+                             double Rd) {
+         return evaluate_side_lobe_ratio(RL, eL, Rd, p.wl, p.px, p.py, p.pz,
+                                         p.th_main, p.N);
+       }},
+      {"averaged_directivity", [](const ObjectiveParameters &p,
+                                  const std::vector<double> &RL,
+                                  const std::vector< std::complex<double> > &eL,
+                                  double Rd) {
+         Vector VS[3];
+         evaluate_harmonics_xyz(RL, eL, Rd, p.wl, VS, p.N);
+         return averaged_directivity_xyz(VS, p.th, p.ph, p.N);
+       }},
+      {"optimal_orientation", [](const ObjectiveParameters &p,
+                                 const std::vector<double> &RL,
+                                 const std::vector< std::complex<double> > &eL,
+                                 double Rd) {
+         Vector VS[3];
+         double orientation[3];
+         evaluate_harmonics_xyz(RL, eL, Rd, p.wl, VS, p.N);
+         return optimal_directivity_xyz(VS, orientation, p.th, p.ph, p.N);
+       }}};
+    return objectives;
+  }  // end of const std::map<std::string, Objective> &Objectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  ObjectiveParameters ReadParameters(const std::map<std::string, double> &params) {
+    ObjectiveParameters p;
+    for (const auto &param : params) {
+      const std::string &key = param.first;
+      const double value = param.second;
+      if (key == "NL") p.NL = static_cast<int>(value);
+      else if (key == "N") p.N = static_cast<int>(value);
+      else if (key == "wl") p.wl = value;
+      else if (key == "px") p.px = value;
+      else if (key == "py") p.py = value;
+      else if (key == "pz") p.pz = value;
+      else if (key == "th") p.th = value;
+      else if (key == "ph") p.ph = value;
+      else if (key == "host_index") p.host_index = value;
+      else if (key == "th_cone") p.th_cone = value;
+      else if (key == "th_main") p.th_main = value;
+      else throw py::value_error("Unknown objective parameter " + key);
+    }
+    if (p.NL < 1 || p.N < 2 || p.wl <= 0)
+      throw py::value_error("Wrong objective parameters!");
+    return p;
+  }  // end of ObjectiveParameters ReadParameters()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void EnsureMPI() {
+    int is_initialized = 0;
+    MPI_Initialized(&is_initialized);
+    if (is_initialized) return;
+    int provided = 0;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
+    py::module::import("atexit").attr("register")(py::cpp_function([]() {
+          int is_finalized = 0;
+          MPI_Finalized(&is_finalized);
+          if (!is_finalized) MPI_Finalize();
+        }));
+  }  // end of void EnsureMPI()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Set the fitness of an engine (SubPopulation, CMAES, ...)
+  /// to a native objective or a Python callable.
+  template <class Engine>
+  void SetObjective(py::object objective, long dimension,              // NOLINT
+                    const std::map<std::string, double> &params,
+                    bool vectorized, Engine *engine) {
+    if (py::isinstance<py::str>(objective)) {
+      const std::string name = objective.cast<std::string>();
+      for (const auto &f : jade::TestFunctions()) {
+        if (name != f.name) continue;
+        // Test functions of functions.py, vectorized over a generation.
+        if (!params.empty())
+          throw py::value_error("test functions take no params");
+        engine->BatchFitnessFunction = f.batch;
+        return;
+      }
+      const auto entry = Objectives().find(name);
+      if (entry == Objectives().end())
+        throw py::value_error("Unknown objective " + name);
+      const ObjectiveParameters p = ReadParameters(params);
+      if (dimension != 2*p.NL + 1)
+        throw py::value_error("Objective " + name + " needs 2*NL+1 limits");
+      const Objective evaluate = entry->second;
+      engine->FitnessFunction = [p, evaluate](const double *x, long) {  // NOLINT
+        double Rd;
+        std::vector<double> RL;
+        std::vector< std::complex<double> > eL;
+        if (!decode_design(x, p.NL, p.host_index, RL, eL, Rd)) return 0.;
+        const double f = evaluate(p, RL, eL, Rd);
+        return std::isnan(f) ? 0. : f;
+      };
+    } else if (py::isinstance<py::function>(objective)) {
+      if (!params.empty())
+        throw py::value_error("params are used by native objectives only");
+      py::function callback = objective.cast<py::function>();
+      // Trial vectors of a generation come in one batch, the GIL is
+      // taken once for it.
+      engine->BatchFitnessFunction = [callback, vectorized]
+          (const double *x, long size, long dimension, double *fitness) {  // NOLINT
+        py::gil_scoped_acquire acquire;
+        if (vectorized) {
+          py::array_t<double> X({size, dimension}, x);
+          auto F = callback(X).cast<py::array_t<double, py::array::c_style
+                                                | py::array::forcecast> >();
+          if (F.size() != size)
+            throw py::value_error("vectorized fitness should return "
+                                  "an array of a value per row");
+          std::copy(F.data(), F.data() + size, fitness);
+          return;
+        }
+        for (long i = 0; i < size; ++i)                                // NOLINT
+          fitness[i] = callback(py::array_t<double>(dimension, x + i*dimension))
+              .cast<double>();
+      };
+    } else {
+      throw py::type_error("objective should be a name of pyjade.objectives()"
+                           " or a callable");
+    }
+  }  // end of void SetObjective()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ReadLimits(const std::vector<std::pair<double, double> > &limits,
+                  std::vector<double> *lbound, std::vector<double> *ubound) {
+    if (limits.empty()) throw py::value_error("limits should not be empty");
+    for (const auto &limit : limits) {
+      lbound->push_back(limit.first);
+      ubound->push_back(limit.second);
+    }
+  }  // end of void ReadLimits()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief pyfde.JADE-like wrapper of SubPopulation, run() continues
+  /// the optimization started by its first call.
+  class PyJADE {
+   public:
+    PyJADE(py::object objective, const std::vector<std::pair<double, double> > &limits,
+           long population, const std::map<std::string, double> &params,  // NOLINT
+           bool maximize, unsigned long seed, bool vectorized) {          // NOLINT
+      std::vector<double> lbound, ubound;
+      ReadLimits(limits, &lbound, &ubound);
+      EnsureMPI();
+      const long dimension = limits.size();                              // NOLINT
+      SetObjective(objective, dimension, params, vectorized, &sube_);
+      sube_.Init(population, dimension);
+      sube_.SetCommunicator(MPI_COMM_SELF);
+      if (seed) sube_.SetSeed(seed);
+      sube_.SetVerbose(false);
+      sube_.SetAllBoundsVectors(lbound, ubound);
+      if (maximize) sube_.SetTargetToMaximum();
+      else sube_.SetTargetToMinimum();
+    }  // end of PyJADE::PyJADE()
+    /// @brief Returns (best, fitness) after `generations` more
+    /// generations (or the end of the budget).
+    py::tuple Run(long generations) {                                    // NOLINT
+      if (generations < 1) throw py::value_error("generations should be >= 1");
+      int status = jade::kDone;
+      try {
+        py::gil_scoped_release release;
+        if (!is_started_) {
+          sube_.SetTotalGenerationsMax(generations);
+          status = sube_.RunOptimization();
+          is_started_ = true;
+        } else {
+          status = sube_.ContinueOptimization(generations);
+        }
+      } catch(...) {
+        // A failed fitness call leaves a generation incomplete.
+        is_started_ = false;
+        throw;
+      }
+      if (status != jade::kDone)
+        throw std::runtime_error("JADE optimization failed!");
+      double fitness = 0;
+      const std::vector<double> best = sube_.GetBest(&fitness);
+      return py::make_tuple(py::array_t<double>(best.size(), best.data()),
+                            fitness);
+    }  // end of py::tuple PyJADE::Run()
+    /// @brief Start over with a new population on the next run().
+    void Reset() {is_started_ = false;}
+    jade::SubPopulation *operator->() {return &sube_;}
+
+   private:
+    jade::SubPopulation sube_;
+    bool is_started_ = false;
+  };  // end of class PyJADE
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Common part of the wrappers of single-process engines
+  /// (jade::Optimizer), run() optimizes from scratch.
+  template <class Engine>
+  class PyOptimizer {
+   public:
+    PyOptimizer(py::object objective,
+                const std::vector<std::pair<double, double> > &limits,
+                const std::map<std::string, double> &params, bool maximize,
+                unsigned long seed, bool vectorized, long evaluations) {  // NOLINT
+      std::vector<double> lbound, ubound;
+      ReadLimits(limits, &lbound, &ubound);
+      const long dimension = limits.size();                              // NOLINT
+      SetObjective(objective, dimension, params, vectorized, &engine_);
+      engine_.Init(dimension);
+      if (seed) engine_.SetSeed(seed);
+      engine_.SetAllBoundsVectors(lbound, ubound);
+      if (maximize) engine_.SetTargetToMaximum();
+      else engine_.SetTargetToMinimum();
+      engine_.SetEvaluationBudget(evaluations);
+    }  // end of PyOptimizer::PyOptimizer()
+    py::tuple Run() {
+      {
+        py::gil_scoped_release release;
+        engine_.RunOptimization();
+      }
+      double fitness = 0;
+      const std::vector<double> best = engine_.GetBest(&fitness);
+      return py::make_tuple(py::array_t<double>(best.size(), best.data()),
+                            fitness);
+    }  // end of py::tuple PyOptimizer::Run()
+    Engine *operator->() {return &engine_;}
+
+   protected:
+    Engine engine_;
+  };  // end of class PyOptimizer
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief CMA-ES run with restarts until the budget is spent.
+  class PyCMAES : public PyOptimizer<jade::CMAES> {
+   public:
+    PyCMAES(py::object objective, const std::vector<std::pair<double, double> > &limits,
+            const std::map<std::string, double> &params, bool maximize,
+            unsigned long seed, bool vectorized, long population,     // NOLINT
+            double sigma, bool separable, std::string restarts,
+            long max_restarts, long evaluations)                      // NOLINT
+        : PyOptimizer(objective, limits, params, maximize, seed, vectorized,
+                      evaluations) {
+      jade::Restarts kind = jade::kNoRestarts;
+      if (restarts == "ipop") kind = jade::kIPOP;
+      else if (restarts == "bipop") kind = jade::kBIPOP;
+      else if (restarts != "none")
+        throw py::value_error("restarts should be none, ipop or bipop");
+      engine_.SetPopulation(population);
+      engine_.SetSigma(sigma);
+      engine_.SetSeparable(separable);
+      engine_.SetRestarts(kind, max_restarts);
+    }  // end of PyCMAES::PyCMAES()
+  };  // end of class PyCMAES
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief one_plus_one() of algorithms/genetic.py.
+  class PyOnePlusOne : public PyOptimizer<jade::OnePlusOne> {
+   public:
+    PyOnePlusOne(py::object objective,
+                 const std::vector<std::pair<double, double> > &limits,
+                 const std::map<std::string, double> &params, bool maximize,
+                 unsigned long seed, bool vectorized, long max_plato_time,  // NOLINT
+                 long chains, long generations, long evaluations)          // NOLINT
+        : PyOptimizer(objective, limits, params, maximize, seed, vectorized,
+                      evaluations) {
+      engine_.SetMaxPlatoTime(max_plato_time);
+      engine_.SetChains(chains);
+      engine_.SetGenerations(generations);
+    }  // end of PyOnePlusOne::PyOnePlusOne()
+  };  // end of class PyOnePlusOne
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief genetic() of algorithms/genetic.py.
+  class PyGenetic : public PyOptimizer<jade::Genetic> {
+   public:
+    PyGenetic(py::object objective,
+              const std::vector<std::pair<double, double> > &limits,
+              const std::map<std::string, double> &params, bool maximize,
+              unsigned long seed, bool vectorized, long generations,  // NOLINT
+              long popsize, double elitepercent, double crossoveredpercent,  // NOLINT
+              double sbbx_eta, long evaluations)                      // NOLINT
+        : PyOptimizer(objective, limits, params, maximize, seed, vectorized,
+                      evaluations) {
+      engine_.SetGenerations(generations);
+      engine_.SetPopulation(popsize);
+      engine_.SetFractions(elitepercent, crossoveredpercent);
+      engine_.SetEta(sbbx_eta);
+    }  // end of PyGenetic::PyGenetic()
+  };  // end of class PyGenetic
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief NSGA-II, run() returns the front of a new run.
+  class PyNSGA2 {
+   public:
+    PyNSGA2(py::object objective,
+            const std::vector<std::pair<double, double> > &limits,
+            std::vector<bool> maximize,
+            const std::map<std::string, double> &params,
+            unsigned long seed, bool vectorized, long population,     // NOLINT
+            long generations, long evaluations) {                     // NOLINT
+      std::vector<double> lbound, ubound;
+      ReadLimits(limits, &lbound, &ubound);
+      const long dimension = limits.size();                              // NOLINT
+      if (py::isinstance<py::str>(objective)) {
+        if (objective.cast<std::string>() != "emission")
+          throw py::value_error("Unknown multi-objective " +
+                                objective.cast<std::string>());
+        const ObjectiveParameters p = ReadParameters(params);
+        if (dimension != 2*p.NL + 1)
+          throw py::value_error("Objective emission needs 2*NL+1 limits");
+        if (maximize.empty()) maximize = {true, true, false};
+        if (maximize.size() != 3)
+          throw py::value_error("emission has 3 objectives");
+        engine_.ObjectivesFunction = [p](const double *x, long,         // NOLINT
+                                         double *objectives) {
+          double Rd;
+          std::vector<double> RL;
+          std::vector< std::complex<double> > eL;
+          const bool valid = decode_design(x, p.NL, p.host_index, RL, eL, Rd);
+          objectives[0] = objectives[1] = 0.;
+          objectives[2] = RL.back()/p.wl;
+          if (!valid) return;
+          const Emission E = evaluate_emission(RL, eL, Rd, p.wl, p.px, p.py,
+                                               p.pz, p.th, p.ph, p.N);
+          objectives[0] = E.D;
+          objectives[1] = E.P;
+        };
+      } else if (py::isinstance<py::function>(objective)) {
+        if (!params.empty())
+          throw py::value_error("params are used by native objectives only");
+        if (maximize.empty())
+          throw py::value_error("maximize should have a flag per objective");
+        py::function callback = objective.cast<py::function>();
+        const long count = maximize.size();                              // NOLINT
+        engine_.BatchObjectivesFunction = [callback, vectorized, count]
+            (const double *x, long size, long dimension, double *objectives) {  // NOLINT
+          py::gil_scoped_acquire acquire;
+          typedef py::array_t<double, py::array::c_style
+                              | py::array::forcecast> Array;
+          if (vectorized) {
+            py::array_t<double> X({size, dimension}, x);
+            auto F = callback(X).cast<Array>();
+            if (F.size() != size*count)
+              throw py::value_error("vectorized objectives should return "
+                                    "an array of a row per vector");
+            std::copy(F.data(), F.data() + size*count, objectives);
+            return;
+          }
+          for (long i = 0; i < size; ++i) {                              // NOLINT
+            auto F = callback(py::array_t<double>(dimension, x + i*dimension))
+                .cast<Array>();
+            if (F.size() != count)
+              throw py::value_error("objectives should return a value per "
+                                    "flag of maximize");
+            std::copy(F.data(), F.data() + count, objectives + i*count);
+          }
+        };
+      } else {
+        throw py::type_error("objective should be \"emission\" or a "
+                             "callable");
+      }
+      engine_.Init(dimension);
+      if (seed) engine_.SetSeed(seed);
+      engine_.SetAllBoundsVectors(lbound, ubound);
+      engine_.SetObjectives(maximize);
+      engine_.SetPopulation(population);
+      engine_.SetGenerations(generations);
+      engine_.SetEvaluationBudget(evaluations);
+    }  // end of PyNSGA2::PyNSGA2()
+    /// @brief Returns (front, objectives) as 2D arrays, a row per
+    /// non-dominated vector.
+    py::tuple Run() {
+      {
+        py::gil_scoped_release release;
+        engine_.RunOptimization();
+      }
+      std::vector<std::vector<double> > objectives;
+      const std::vector<std::vector<double> > front =
+          engine_.GetFront(&objectives);
+      const long size = front.size();                                    // NOLINT
+      const long n = size ? front[0].size() : 0;                         // NOLINT
+      const long m = size ? objectives[0].size() : 0;                    // NOLINT
+      std::vector<double> x, f;
+      for (long i = 0; i < size; ++i) {                                  // NOLINT
+        x.insert(x.end(), front[i].begin(), front[i].end());
+        f.insert(f.end(), objectives[i].begin(), objectives[i].end());
+      }
+      return py::make_tuple(py::array_t<double>({size, n}, x.data()),
+                            py::array_t<double>({size, m}, f.data()));
+    }  // end of py::tuple PyNSGA2::Run()
+    jade::NSGA2 *operator->() {return &engine_;}
+
+   private:
+    jade::NSGA2 engine_;
+  };  // end of class PyNSGA2
+}  // end of namespace
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+PYBIND11_MODULE(pyjade, m) {
+  m.doc() = "JADE++ adaptive differential evolution with native "
+      "sphereml objectives";
+
+  m.def("objectives", []() {
+      std::vector<std::string> names;
+      for (const auto &entry : Objectives()) names.push_back(entry.first);
+      for (const auto &f : jade::TestFunctions()) names.push_back(f.name);
+      return names;
+    }, "names of the native objectives and test functions");
+
+  m.def("test_bounds", [](std::string name) {
+      for (const auto &f : jade::TestFunctions())
+        if (name == f.name) return py::make_tuple(f.lbound, f.ubound);
+      throw py::value_error("Unknown test function " + name);
+    }, "(lbound, rbound) of a test function of functions.py",
+    py::arg("name"));
+
+  m.def("open_store", &open_eval_store,
+        "memoize the directivity of native objectives in a memory-mapped "
+        "file shared by processes (created if missing, the defaults make "
+        "a sparse file of about 1 GiB)",
+        py::arg("file"), py::arg("slots") = 1L << 20,
+        py::arg("data_mb") = 1024);
+
+  m.def("close_store", &close_eval_store, "stop using the evaluation store");
+
+  py::class_<PyJADE>(m, "JADE")
+      .def(py::init<py::object, const std::vector<std::pair<double, double> > &,
+           long, const std::map<std::string, double> &, bool,  // NOLINT
+           unsigned long, bool>(),                                 // NOLINT
+           "objective is a name of objectives() or a callable f(x), "
+           "limits is a list of (lower, upper) bounds",
+           py::arg("objective"), py::arg("limits"),
+           py::arg("population") = 75,
+           py::arg("params") = std::map<std::string, double>(),
+           py::arg("maximize") = true, py::arg("seed") = 0,
+           py::arg("vectorized") = false)
+      .def("run", &PyJADE::Run,
+           "evolve for n_it more generations, returns (best, fitness)",
+           py::arg("n_it") = 1000)
+      .def("reset", &PyJADE::Reset,
+           "start over with a new population on the next run()")
+      .def("set_history_memory", [](PyJADE &s, long size) {  // NOLINT
+          s->SetHistoryMemory(size);
+        }, "SHADE success-history memory of `size` entries (0 - JADE)",
+        py::arg("size"))
+      .def("set_population_reduction",
+           [](PyJADE &s, long min_population, long max_evaluations) {  // NOLINT
+             s->SetPopulationReduction(min_population, max_evaluations);
+           }, "L-SHADE linear population size reduction",
+           py::arg("min_population"), py::arg("max_evaluations"))
+      .def("set_evaluation_budget", [](PyJADE &s, long evaluations) {  // NOLINT
+          s->SetEvaluationBudget(evaluations);
+        }, "stop before exceeding `evaluations` fitness evaluations",
+        py::arg("evaluations"))
+      .def("set_convergence",
+           [](PyJADE &s, double fitness_spread, double diameter,
+              long stall_generations) {  // NOLINT
+             s->SetConvergence(fitness_spread, diameter, stall_generations);
+           }, "collapse criteria (0 switches a criterion off)",
+           py::arg("fitness_spread") = 0., py::arg("diameter") = 0.,
+           py::arg("stall_generations") = 0)
+      .def("set_restarts", [](PyJADE &s, double population_factor) {
+          s->SetRestarts(population_factor);
+        }, "IPOP restarts of a collapsed population (0 - stop instead)",
+        py::arg("population_factor"))
+      .def("set_polishing",
+           [](PyJADE &s, long interval, long count, long evaluations) {  // NOLINT
+             s->SetPolishing(interval, count, evaluations);
+           }, "refine the `count` best individuals by L-BFGS every "
+           "`interval` generations (0 - when finished)",
+           py::arg("interval"), py::arg("count") = 1,
+           py::arg("evaluations") = 0)
+      .def("set_surrogate",
+           [](PyJADE &s, long capacity, long candidates, double kappa) {  // NOLINT
+             s->SetSurrogate(capacity, candidates, kappa);
+           }, "evaluate the best of `candidates` trials per individual "
+           "predicted by a Gaussian process of `capacity` points",
+           py::arg("capacity"), py::arg("candidates") = 4,
+           py::arg("kappa") = 0.)
+      .def("set_checkpoint", [](PyJADE &s, std::string file, long interval) {  // NOLINT
+          s->SetCheckpoint(file, interval);
+        }, "save the state every `interval` generations, resume from it",
+        py::arg("file"), py::arg("interval") = 100)
+      .def("set_parallel_evaluation", [](PyJADE &s, bool is_parallel) {
+          s->SetParallelEvaluation(is_parallel);
+        }, "evaluate native objectives in OpenMP threads (default)",
+        py::arg("is_parallel"))
+      .def_property_readonly("generation", [](PyJADE &s) {
+          return s->GetCurrentGeneration();
+        })
+      .def_property_readonly("evaluations", [](PyJADE &s) {
+          return s->GetEvaluations();
+        })
+      .def_property_readonly("population", [](PyJADE &s) {
+          return s->GetPopulation();
+        })
+      .def_property_readonly("restarts", [](PyJADE &s) {
+          return s->GetRestarts();
+        })
+      .def_property_readonly("screened_trials", [](PyJADE &s) {
+          return s->GetScreenedTrials();
+        })
+      .def_property_readonly("finished", [](PyJADE &s) {
+          return s->IsFinished();
+        });
+
+  py::class_<PyCMAES>(m, "CMAES")
+      .def(py::init<py::object, const std::vector<std::pair<double, double> > &,
+           const std::map<std::string, double> &, bool, unsigned long,  // NOLINT
+           bool, long, double, bool, std::string, long, long>(),       // NOLINT
+           "CMA-ES in the box of limits with pwqb bound handling, sigma "
+           "is in units of a tenth of the box",
+           py::arg("objective"), py::arg("limits"),
+           py::arg("params") = std::map<std::string, double>(),
+           py::arg("maximize") = true, py::arg("seed") = 0,
+           py::arg("vectorized") = false, py::arg("population") = 0,
+           py::arg("sigma") = 2., py::arg("separable") = false,
+           py::arg("restarts") = "bipop", py::arg("max_restarts") = 9,
+           py::arg("evaluations") = 0)
+      .def("run", &PyCMAES::Run,
+           "optimize until the budget is spent or the last descent "
+           "stops, returns (best, fitness)")
+      .def_property_readonly("evaluations", [](PyCMAES &s) {
+          return s->GetEvaluations();
+        })
+      .def_property_readonly("restarts", [](PyCMAES &s) {
+          return s->GetRestarts();
+        })
+      .def_property_readonly("generations", [](PyCMAES &s) {
+          return s->GetGenerations();
+        })
+      .def_property_readonly("stop_reason", [](PyCMAES &s) {
+          return s->GetStopReason();
+        });
+
+  py::class_<PyOnePlusOne>(m, "OnePlusOne")
+      .def(py::init<py::object, const std::vector<std::pair<double, double> > &,
+           const std::map<std::string, double> &, bool, unsigned long,  // NOLINT
+           bool, long, long, long, long>(),                             // NOLINT
+           "(1+1)-ES with the 1/5th success rule, a chain restarts after "
+           "max_plato_time generations without improvement; set "
+           "evaluations or generations",
+           py::arg("objective"), py::arg("limits"),
+           py::arg("params") = std::map<std::string, double>(),
+           py::arg("maximize") = true, py::arg("seed") = 0,
+           py::arg("vectorized") = false, py::arg("max_plato_time") = 100,
+           py::arg("chains") = 1, py::arg("generations") = 0,
+           py::arg("evaluations") = 0)
+      .def("run", &PyOnePlusOne::Run,
+           "optimize until the budget or the generations are spent, "
+           "returns (best, fitness)")
+      .def_property_readonly("evaluations", [](PyOnePlusOne &s) {
+          return s->GetEvaluations();
+        })
+      .def_property_readonly("restarts", [](PyOnePlusOne &s) {
+          return s->GetRestarts();
+        })
+      .def_property_readonly("generations", [](PyOnePlusOne &s) {
+          return s->GetGenerations();
+        });
+
+  py::class_<PyGenetic>(m, "Genetic")
+      .def(py::init<py::object, const std::vector<std::pair<double, double> > &,
+           const std::map<std::string, double> &, bool, unsigned long,  // NOLINT
+           bool, long, long, double, double, double, long>(),           // NOLINT
+           "genetic algorithm with elitism, SBX crossover and Gaussian "
+           "mutation",
+           py::arg("objective"), py::arg("limits"),
+           py::arg("params") = std::map<std::string, double>(),
+           py::arg("maximize") = true, py::arg("seed") = 0,
+           py::arg("vectorized") = false, py::arg("generations") = 300,
+           py::arg("popsize") = 20, py::arg("elitepercent") = .1,
+           py::arg("crossoveredpercent") = .4, py::arg("sbbx_eta") = 1.,
+           py::arg("evaluations") = 0)
+      .def("run", &PyGenetic::Run,
+           "evolve for the generations (or until the budget is spent), "
+           "returns (best, fitness)")
+      .def_property_readonly("evaluations", [](PyGenetic &s) {
+          return s->GetEvaluations();
+        })
+      .def_property_readonly("generations", [](PyGenetic &s) {
+          return s->GetGenerations();
+        });
+
+  py::class_<PyNSGA2>(m, "NSGA2")
+      .def(py::init<py::object, const std::vector<std::pair<double, double> > &,
+           std::vector<bool>, const std::map<std::string, double> &,
+           unsigned long, bool, long, long, long>(),                    // NOLINT
+           "NSGA-II, objective is \"emission\" or a callable f(x) -> "
+           "objectives with a flag per objective in maximize",
+           py::arg("objective"), py::arg("limits"),
+           py::arg("maximize") = std::vector<bool>(),
+           py::arg("params") = std::map<std::string, double>(),
+           py::arg("seed") = 0, py::arg("vectorized") = false,
+           py::arg("population") = 100, py::arg("generations") = 250,
+           py::arg("evaluations") = 0)
+      .def("run", &PyNSGA2::Run,
+           "evolve for the generations (or until the budget is spent), "
+           "returns (front, objectives)")
+      .def("set_crossover", [](PyNSGA2 &s, double probability, double eta) {
+          s->SetCrossover(probability, eta);
+        }, "probability of mating a pair and the SBX distribution index",
+        py::arg("probability") = .9, py::arg("eta") = 20.)
+      .def("set_mutation", [](PyNSGA2 &s, double probability, double eta) {
+          s->SetMutation(probability, eta);
+        }, "probability of mutating a coordinate (0 - 1/dimension) and "
+        "the distribution index", py::arg("probability") = 0.,
+        py::arg("eta") = 20.)
+      .def_property_readonly("evaluations", [](PyNSGA2 &s) {
+          return s->GetEvaluations();
+        })
+      .def_property_readonly("generations", [](PyNSGA2 &s) {
+          return s->GetGenerations();
+        });
+}
@@ -20,6 +20,8 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 #include "./matrix.h"
 #include "./sphereml.h"
 #include "./directivity.h"
+#include "./evalstore.h"
+#include "./scan.h"
 
 #include <math.h>
 #include <cmath>
@@ -75,6 +77,197 @@ double py_evaluate_directivity(const py::array_t<double, py::array::c_style | py
     return evaluate_directivity(c_RL, c_eL, Rd, wl, px, py, pz, th, ph, N);
 }
 
+double py_evaluate_cone_efficiency(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                   const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                   const double Rd, const double wl,
+                                   const double px, const double py, const double pz,
+                                   const double th_cone,
+                                   const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    return evaluate_cone_efficiency(c_RL, c_eL, Rd, wl, px, py, pz, th_cone, N);
+}
+
+double py_evaluate_side_lobe_ratio(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                   const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                   const double Rd, const double wl,
+                                   const double px, const double py, const double pz,
+                                   const double th_main,
+                                   const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    return evaluate_side_lobe_ratio(c_RL, c_eL, Rd, wl, px, py, pz, th_main, N);
+}
+
+
+py::array_t<double> py_evaluate_orientations(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                             const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                             const double Rd, const double wl,
+                                             const py::array_t<double, py::array::c_style | py::array::forcecast> &p,
+                                             const double th, const double ph,
+                                             const int N) {
+    if (p.size() % 3 != 0) throw py::value_error("p should be an array of (px, py, pz) rows");
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    const auto& c_p = Py2VectorDouble(p);
+    const long np = c_p.size()/3;
+    Vector VS[3];
+    evaluate_harmonics_xyz(c_RL, c_eL, Rd, wl, VS, N);
+    py::array_t<double> res(np);
+    double *D = res.mutable_data();
+    for (long i = 0; i < np; ++i)
+      D[i] = directivity_xyz(VS, c_p[3*i], c_p[3*i+1], c_p[3*i+2], th, ph, N);
+    return res;
+}
+
+double py_evaluate_averaged_directivity(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                        const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                        const double Rd, const double wl,
+                                        const double th, const double ph,
+                                        const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    Vector VS[3];
+    evaluate_harmonics_xyz(c_RL, c_eL, Rd, wl, VS, N);
+    return averaged_directivity_xyz(VS, th, ph, N);
+}
+
+py::tuple py_evaluate_optimal_orientation(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                          const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                          const double Rd, const double wl,
+                                          const double th, const double ph,
+                                          const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    Vector VS[3];
+    double p[3];
+    evaluate_harmonics_xyz(c_RL, c_eL, Rd, wl, VS, N);
+    const double D = optimal_directivity_xyz(VS, p, th, ph, N);
+    return py::make_tuple(D, py::array_t<double>(3, p));
+}
+
+py::tuple py_evaluate_efficiencies(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                   const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                   const py::array_t<double, py::array::c_style | py::array::forcecast> &wl,
+                                   const int N) {
+    const long NL = (RL.ndim() > 1) ? RL.shape(RL.ndim()-1) : RL.size();
+    const long nd = (NL > 0) ? RL.size()/NL : 0, nwl = wl.size();
+    if (NL < 1 || (eL.size() != nd*(NL+1) && eL.size() != nd*nwl*(NL+1)))
+      throw py::value_error("eL should have shape (designs, NL+1) or (designs, wavelengths, NL+1)");
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    const auto& c_wl = Py2VectorDouble(wl);
+    std::vector<Efficiencies> Q;
+    {
+      py::gil_scoped_release release;
+      evaluate_efficiency_spectra(c_RL, c_eL, NL, c_wl, Q, N);
+    }
+    std::vector<ssize_t> shape = {nd, nwl};
+    py::array_t<double> Qsca(shape), Qext(shape), Qabs(shape), Qback(shape), g(shape);
+    double *pQsca = Qsca.mutable_data(), *pQext = Qext.mutable_data(), *pQabs = Qabs.mutable_data(),
+        *pQback = Qback.mutable_data(), *pg = g.mutable_data();
+    for (size_t i = 0; i < Q.size(); ++i) {
+      pQsca[i] = Q[i].Qsca; pQext[i] = Q[i].Qext; pQabs[i] = Q[i].Qabs;
+      pQback[i] = Q[i].Qback; pg[i] = Q[i].g;
+    }
+    return py::make_tuple(Qsca, Qext, Qabs, Qback, g);
+}
+
+py::tuple py_canonical_design(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                              const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                              const double Rd) {
+    auto c_RL = Py2VectorDouble(RL);
+    auto c_eL = Py2VectorComplex(eL);
+    if (c_eL.size() != c_RL.size() + 1) throw py::value_error("eL should have a value per layer and the host one");
+    const bool valid = canonical_design(c_RL, c_eL, Rd);
+    return py::make_tuple(py::array_t<double>(c_RL.size(), c_RL.data()),
+                          py::array_t< std::complex<double> >(c_eL.size(), c_eL.data()), valid);
+}
+
+py::tuple Scan2Py(const std::vector<ScanPoint> &samples, const std::vector<ScanPoint> &peaks) {
+    py::array_t<double> t(samples.size()), f(samples.size()), tp(peaks.size()), fp(peaks.size());
+    for (size_t i=0; i<samples.size(); ++i) {t.mutable_data()[i] = samples[i].t; f.mutable_data()[i] = samples[i].f;}
+    for (size_t i=0; i<peaks.size(); ++i) {tp.mutable_data()[i] = peaks[i].t; fp.mutable_data()[i] = peaks[i].f;}
+    return py::make_tuple(t, f, tp, fp);
+}
+
+ScanSettings Py2ScanSettings(const int initial, const double tol, const double max_change,
+                             const double min_step, const double peak_tol, const long max_evaluations) {
+    ScanSettings S;
+    S.initial = initial; S.tol = tol; S.max_change = max_change;
+    S.min_step = min_step; S.peak_tol = peak_tol; S.max_evaluations = max_evaluations;
+    return S;
+}
+
+py::tuple py_scan_directivity_rd(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                 const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                 const double wl,
+                                 const double Rd_min, const double Rd_max,
+                                 const double px, const double py, const double pz,
+                                 const double th, const double ph,
+                                 const int N,
+                                 const int initial, const double tol, const double max_change,
+                                 const double min_step, const double peak_tol, const long max_evaluations) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    std::vector<ScanPoint> peaks;
+    const ScanSettings S = Py2ScanSettings(initial, tol, max_change, min_step, peak_tol, max_evaluations);
+    const auto& samples = scan_directivity_rd(c_RL, c_eL, wl, px, py, pz, Rd_min, Rd_max, &peaks, S, th, ph, N);
+    return Scan2Py(samples, peaks);
+}
+
+py::tuple py_scan_directivity_wl(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                 const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                 const double Rd,
+                                 const double wl_min, const double wl_max,
+                                 const double px, const double py, const double pz,
+                                 const double th, const double ph,
+                                 const int N,
+                                 const int initial, const double tol, const double max_change,
+                                 const double min_step, const double peak_tol, const long max_evaluations) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    std::vector<ScanPoint> peaks;
+    const ScanSettings S = Py2ScanSettings(initial, tol, max_change, min_step, peak_tol, max_evaluations);
+    const auto& samples = scan_directivity_wl(c_RL, c_eL, Rd, px, py, pz, wl_min, wl_max, &peaks, S, th, ph, N);
+    return Scan2Py(samples, peaks);
+}
+
+py::tuple NearField2Py(const FieldExpansion &FE,
+                       const py::array_t<double, py::array::c_style | py::array::forcecast> &xyz) {
+    if (xyz.size() % 3 != 0) throw py::value_error("xyz should be an array of (x, y, z) rows");
+    const long np = xyz.size()/3;
+    std::vector<ssize_t> shape = {np, 3};
+    py::array_t< std::complex<double> > E(shape), H(shape);
+    const double *c_xyz = xyz.data();
+    std::complex<double> *c_E = E.mutable_data(), *c_H = H.mutable_data();
+    {
+      py::gil_scoped_release release;
+      evaluate_fields(FE, c_xyz, np, c_E, c_H);
+    }
+    return py::make_tuple(E, H);
+}
+
+py::tuple py_evaluate_near_field(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                 const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                 const double Rd, const double wl,
+                                 const py::array_t<double, py::array::c_style | py::array::forcecast> &xyz,
+                                 const double px, const double py, const double pz,
+                                 const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    return NearField2Py(evaluate_field_expansion(c_RL, c_eL, Rd, wl, px, py, pz, N), xyz);
+}
+
+py::tuple py_evaluate_plane_wave_near_field(const py::array_t<double, py::array::c_style | py::array::forcecast> &RL,
+                                            const py::array_t< std::complex<double>, py::array::c_style | py::array::forcecast> &eL,
+                                            const double wl,
+                                            const py::array_t<double, py::array::c_style | py::array::forcecast> &xyz,
+                                            const int N) {
+    const auto& c_RL = Py2VectorDouble(RL);
+    const auto& c_eL = Py2VectorComplex(eL);
+    return NearField2Py(evaluate_plane_wave_expansion(c_RL, c_eL, wl, N), xyz);
+}
 
 PYBIND11_MODULE(sphereml, m) {
     m.doc() = "sphereml evaluates excitation of a multilayerd sphere by a dipole source"; // optional module docstring
@@ -91,5 +284,102 @@ PYBIND11_MODULE(sphereml, m) {
           py::arg("Rd"), py::arg("wl"),
           py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
           py::arg("N")=41);
+
+    m.def("evaluate_cone_efficiency", &py_evaluate_cone_efficiency,
+          "fraction of the radiated power inside the cone th < th_cone",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
+          py::arg("th_cone")=M_PI/6.,
+          py::arg("N")=41);
+
+    m.def("evaluate_side_lobe_ratio", &py_evaluate_side_lobe_ratio,
+          "directivity at th=0 over the maximum directivity at th >= th_main",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
+          py::arg("th_main")=M_PI/6.,
+          py::arg("N")=41);
+
+    m.def("evaluate_orientations", &py_evaluate_orientations,
+          "directivity for each dipole orientation (rows of p), one multilayer solve",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("p"),
+          py::arg("th")=0., py::arg("ph")=0.,
+          py::arg("N")=41);
+
+    m.def("evaluate_averaged_directivity", &py_evaluate_averaged_directivity,
+          "directivity of randomly oriented dipoles",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("th")=0., py::arg("ph")=0.,
+          py::arg("N")=41);
+
+    m.def("evaluate_optimal_orientation", &py_evaluate_optimal_orientation,
+          "maximum directivity over dipole orientations, returns (D, p)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("th")=0., py::arg("ph")=0.,
+          py::arg("N")=41);
+
+    m.def("evaluate_efficiencies", &py_evaluate_efficiencies,
+          "plane-wave efficiencies for designs x wavelengths, returns (Qsca, Qext, Qabs, Qback, g)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("wl"),
+          py::arg("N")=41);
+
+    m.def("evaluate_near_field", &py_evaluate_near_field,
+          "E and Z0*H of the dipole at points xyz (rows), returns (E, H)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl"),
+          py::arg("xyz"),
+          py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
+          py::arg("N")=41);
+
+    m.def("evaluate_plane_wave_near_field", &py_evaluate_plane_wave_near_field,
+          "E and Z0*H for a plane wave along z polarized along y, returns (E, H)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("wl"),
+          py::arg("xyz"),
+          py::arg("N")=41);
+
+    m.def("scan_directivity_rd", &py_scan_directivity_rd,
+          "adaptive scan of the directivity over Rd, refined near resonances, returns "
+          "(Rd, D, Rd_peak, D_peak)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("wl"), py::arg("Rd_min"), py::arg("Rd_max"),
+          py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
+          py::arg("th")=0., py::arg("ph")=0.,
+          py::arg("N")=41,
+          py::arg("initial")=41, py::arg("tol")=1.e-3, py::arg("max_change")=2.e-2,
+          py::arg("min_step")=1.e-6, py::arg("peak_tol")=1.e-9, py::arg("max_evaluations")=5000);
+
+    m.def("scan_directivity_wl", &py_scan_directivity_wl,
+          "adaptive scan of the directivity over the wavelength, refined near resonances, returns "
+          "(wl, D, wl_peak, D_peak)",
+          py::arg("RL"), py::arg("eL"),
+          py::arg("Rd"), py::arg("wl_min"), py::arg("wl_max"),
+          py::arg("px")=1., py::arg("py")=0., py::arg("pz")=0.,
+          py::arg("th")=0., py::arg("ph")=0.,
+          py::arg("N")=41,
+          py::arg("initial")=41, py::arg("tol")=1.e-3, py::arg("max_change")=2.e-2,
+          py::arg("min_step")=1.e-6, py::arg("peak_tol")=1.e-9, py::arg("max_evaluations")=5000);
+
+    m.def("canonical_design", &py_canonical_design,
+          "equivalent design with sorted, merged layers, returns (RL, eL, valid); valid is False "
+          "for a dipole on an interface",
+          py::arg("RL"), py::arg("eL"), py::arg("Rd"));
+
+    m.def("open_store", &open_eval_store,
+          "memoize evaluate_harmonics and evaluate_directivity in a memory-mapped file shared "
+          "by processes (created with the given size if missing, the defaults make a sparse file of "
+          "about 1 GiB)",
+          py::arg("file"), py::arg("slots")=1L<<20, py::arg("data_mb")=1024);
+
+    m.def("close_store", &close_eval_store, "stop using the evaluation store");
+
+    m.def("store_entries", []() {return eval_store() ? eval_store()->entries() : 0L;},
+          "number of entries in the open evaluation store");
 }
 
@@ -0,0 +1,207 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#include "scan.h"
+#include "directivity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+static const double golden = 0.3819660112501051; // (3 - sqrt(5))/2
+
+     // estimate of f'' at the sample j from its neighbours
+static inline double second_difference(const std::vector<ScanPoint> &p, const size_t j) {
+     return 2.*((p[j+1].f - p[j].f)/(p[j+1].t - p[j].t) - (p[j].f - p[j-1].f)/(p[j].t - p[j-1].t))
+             /(p[j+1].t - p[j-1].t);
+}
+
+static inline bool by_argument(const ScanPoint &a, const ScanPoint &b) {return a.t < b.t;}
+
+std::vector<ScanPoint> adaptive_scan(const ScanFunction &func,
+                                     const std::vector< std::pair<double,double> > &segments,
+                                     const ScanSettings &S,
+                                     std::vector<ScanPoint> *peaks) {
+     const size_t ns = segments.size();
+     size_t is, i, k, n;
+     long evaluations = 0;
+     double length = 0., lo, hi, scale, h, c, err;
+     std::vector< std::vector<ScanPoint> > P(ns);
+     std::vector<ScanPoint> samples;
+     std::vector<double> t, f;
+     std::vector< std::pair<double, std::pair<size_t,size_t> > > flagged; // (error, (segment, interval))
+     std::vector<size_t> owner;
+
+     if (peaks) peaks->clear();
+     for (is=0; is<ns; ++is) {
+          if (!(segments[is].second > segments[is].first)) throw std::invalid_argument("Scan segments should not be empty!");
+          length += segments[is].second - segments[is].first;
+     }
+     if (ns == 0) throw std::invalid_argument("Scan range is empty!");
+     if (S.initial < 3 || !(S.tol > 0.) || !(S.max_change > 0.) || S.min_step < 0. || S.peak_tol < 0.)
+          throw std::invalid_argument("Scan needs initial >= 3 and positive tolerances!");
+     auto evaluate = [&]() {
+          f.resize(t.size());
+          func(t, f);
+          evaluations += t.size();
+          for (k=0; k<t.size(); ++k) P[owner[k]].push_back({t[k], f[k]});
+     };
+
+          // first pass: uniform samples including the ends of every segment
+     t.clear(); owner.clear();
+     for (is=0; is<ns; ++is) {
+          const double a = segments[is].first, b = segments[is].second;
+          n = std::max(3L, lround(S.initial*(b - a)/length));
+          for (k=0; k<n; ++k) {t.push_back(a + (b - a)*k/(n - 1)); owner.push_back(is);}
+     }
+     if (long(t.size()) > S.max_evaluations)
+          throw std::invalid_argument("Scan budget does not cover the first pass (" + std::to_string(t.size())
+                                      + " samples)!");
+     evaluate();
+
+          // refinement passes
+     while (evaluations < S.max_evaluations) {
+          lo = std::numeric_limits<double>::infinity(); hi = -lo;
+          for (is=0; is<ns; ++is) for (const auto &p : P[is]) if (std::isfinite(p.f)) {
+               lo = std::min(lo, p.f); hi = std::max(hi, p.f);
+          }
+          if (lo > hi) break; // nothing finite
+          scale = hi - lo;
+          if (!(scale > 0.)) scale = std::max(fabs(hi), 1.);
+          flagged.clear();
+          for (is=0; is<ns; ++is) {
+               const auto &p = P[is];
+               n = p.size();
+               for (i=0; i+1<n; ++i) {
+                    h = p[i+1].t - p[i].t;
+                    if (h <= S.min_step*length || !std::isfinite(p[i].f) || !std::isfinite(p[i+1].f)) continue;
+                    c = 0.;
+                    if (i > 0 && std::isfinite(p[i-1].f)) c = std::max(c, fabs(second_difference(p, i)));
+                    if (i+2 < n && std::isfinite(p[i+2].f)) c = std::max(c, fabs(second_difference(p, i+1)));
+                    err = std::max(c*h*h/(8.*S.tol), fabs(p[i+1].f - p[i].f)/S.max_change)/scale;
+                    if (err > 1.) flagged.push_back(std::make_pair(err, std::make_pair(is, i)));
+               }
+          }
+          if (flagged.empty()) break;
+          if (long(flagged.size()) > S.max_evaluations - evaluations) { // the worst intervals first
+               n = S.max_evaluations - evaluations;
+               std::partial_sort(flagged.begin(), flagged.begin() + n, flagged.end(),
+                                 [](const std::pair<double, std::pair<size_t,size_t> > &a,
+                                    const std::pair<double, std::pair<size_t,size_t> > &b)
+                                 {return a.first > b.first;});
+               flagged.resize(n);
+          }
+          t.clear(); owner.clear();
+          for (const auto &fl : flagged) {
+               const auto &p = P[fl.second.first];
+               t.push_back(0.5*(p[fl.second.second].t + p[fl.second.second+1].t));
+               owner.push_back(fl.second.first);
+          }
+          evaluate();
+          for (is=0; is<ns; ++is) std::sort(P[is].begin(), P[is].end(), by_argument);
+     }
+
+          // golden-section searches from the brackets (a, b, c) of the interior maxima, f(b) is the best
+     if (peaks) {
+          struct Bracket {double a, b, c, fb; size_t segment;};
+          std::vector<Bracket> B;
+          for (is=0; is<ns; ++is) {
+               const auto &p = P[is];
+               for (i=1; i+1<p.size(); ++i)
+                    if (p[i].f > p[i-1].f && p[i].f >= p[i+1].f) B.push_back({p[i-1].t, p[i].t, p[i+1].t, p[i].f, is});
+          }
+          while (evaluations < S.max_evaluations) {
+               t.clear(); owner.clear();
+               std::vector<size_t> active;
+               for (k=0; k<B.size() && long(t.size()) < S.max_evaluations - evaluations; ++k) {
+                    const Bracket &r = B[k];
+                    if (r.c - r.a <= S.peak_tol*length) continue;
+                    t.push_back(r.b - r.a > r.c - r.b ? r.b - golden*(r.b - r.a) : r.b + golden*(r.c - r.b));
+                    owner.push_back(r.segment); active.push_back(k);
+               }
+               if (t.empty()) break;
+               evaluate();
+               for (i=0; i<active.size(); ++i) {
+                    Bracket &r = B[active[i]];
+                    if (f[i] > r.fb) {
+                         if (t[i] < r.b) r.c = r.b; else r.a = r.b;
+                         r.b = t[i]; r.fb = f[i];
+                    } else {
+                         if (t[i] < r.b) r.a = t[i]; else r.c = t[i];
+                    }
+               }
+          }
+          for (const auto &r : B) peaks->push_back({r.b, r.fb});
+     }
+
+     for (is=0; is<ns; ++is) samples.insert(samples.end(), P[is].begin(), P[is].end());
+     std::sort(samples.begin(), samples.end(), by_argument);
+     return samples;
+}
+
+std::vector<ScanPoint> scan_directivity_rd(const std::vector<double> &RL_in,
+                                           const std::vector< std::complex<double> > &eL_in,
+                                           const double &wl,
+                                           const double &px, const double &py, const double &pz,
+                                           const double Rd_min, const double Rd_max,
+                                           std::vector<ScanPoint> *peaks,
+                                           const ScanSettings &settings,
+                                           const double th,
+                                           const double ph,
+                                           const int N) {
+     std::vector<double> RL(RL_in);
+     std::vector< std::complex<double> > eL(eL_in);
+     std::vector< std::pair<double,double> > segments;
+     double a = Rd_min, margin;
+          // the directivity has kinks at the interfaces, the dipole stays off them (numpy.isclose)
+     canonical_design(RL, eL, Rd_min);
+     for (const auto r : RL) {
+          margin = 2.*(1.e-8 + 1.e-5*r);
+          if (r + margin <= a || r - margin >= Rd_max) continue;
+          if (r - margin > a) segments.push_back(std::make_pair(a, r - margin));
+          a = r + margin;
+     }
+     if (a < Rd_max) segments.push_back(std::make_pair(a, Rd_max));
+     auto D = [&](const std::vector<double> &Rd, std::vector<double> &f) {
+#pragma omp parallel for schedule(dynamic)
+          for (long k=0; k<long(Rd.size()); ++k)
+               f[k] = evaluate_directivity(RL, eL, Rd[k], wl, px, py, pz, th, ph, N);
+     };
+     return adaptive_scan(D, segments, settings, peaks);
+}
+
+std::vector<ScanPoint> scan_directivity_wl(const std::vector<double> &RL,
+                                           const std::vector< std::complex<double> > &eL,
+                                           const double &Rd,
+                                           const double &px, const double &py, const double &pz,
+                                           const double wl_min, const double wl_max,
+                                           std::vector<ScanPoint> *peaks,
+                                           const ScanSettings &settings,
+                                           const double th,
+                                           const double ph,
+                                           const int N) {
+     auto D = [&](const std::vector<double> &wl, std::vector<double> &f) {
+#pragma omp parallel for schedule(dynamic)
+          for (long k=0; k<long(wl.size()); ++k)
+               f[k] = evaluate_directivity(RL, eL, Rd, wl[k], px, py, pz, th, ph, N);
+     };
+     return adaptive_scan(D, {std::make_pair(wl_min, wl_max)}, settings, peaks);
+}
@@ -0,0 +1,88 @@
+/**
+Copyright © 2019 Alexey A. Shcherbakov. All rights reserved.
+
+This file is part of sphereml.
+
+sphereml is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+sphereml is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with sphereml. If not, see <https://www.gnu.org/licenses/>.
+**/
+
+#ifndef _SCAN_H
+#define _SCAN_H
+
+#include "matrix.h"
+
+#include <complex>
+#include <functional>
+#include <utility>
+#include <vector>
+
+     // Adaptive 1D sampling of a function that is smooth on each of the given segments (e.g. the
+     // directivity between interfaces). A first pass samples the segments uniformly, then every
+     // pass bisects, in one batch, the intervals whose linear interpolation error (estimated from
+     // the second differences of the neighbours) or change of f exceed a tolerance relative to
+     // the range of f seen so far, down to min_step. Local maxima of the samples are then located
+     // by golden-section searches in their brackets, again one batch per step over all of them.
+     // A resonance narrower than the first-pass spacing may be missed, `initial` must resolve
+     // every peak at least by one sample. Empty segments, non-positive tolerances and a budget
+     // smaller than the first pass (at least 3 samples per segment) throw std::invalid_argument.
+struct ScanSettings {
+     int initial = 41;              // samples of the first pass, distributed over the segments
+     double tol = 1.e-3;            // interpolation error relative to the range of f
+     double max_change = 2.e-2;     // change of f between neighbours relative to the range of f
+     double min_step = 1.e-6;       // smallest interval relative to the total length
+     double peak_tol = 1.e-9;       // bracket of a located maximum relative to the total length
+     long max_evaluations = 5000;   // evaluations of the whole scan
+};
+
+struct ScanPoint {
+     double t, f;
+};
+
+     // f(t[k]) for a batch of arguments
+typedef std::function<void(const std::vector<double> &t, std::vector<double> &f)> ScanFunction;
+
+     // samples sorted by t, including the ones of the peak searches; peaks receives the located
+     // interior maxima of the segments
+std::vector<ScanPoint> adaptive_scan(const ScanFunction &f,
+                                     const std::vector< std::pair<double,double> > &segments,
+                                     const ScanSettings &settings,
+                                     std::vector<ScanPoint> *peaks = nullptr);
+
+     // directivity over the dipole position in [Rd_min, Rd_max], scanned piecewise between the
+     // interfaces of the (canonical) multilayer; evaluated with OpenMP threads
+std::vector<ScanPoint> scan_directivity_rd(const std::vector<double> &RL,
+                                           const std::vector< std::complex<double> > &eL,
+                                           const double &wl,
+                                           const double &px, const double &py, const double &pz,
+                                           const double Rd_min, const double Rd_max,
+                                           std::vector<ScanPoint> *peaks = nullptr,
+                                           const ScanSettings &settings = ScanSettings(),
+                                           const double th = 0.,
+                                           const double ph = 0.,
+                                           const int N = 41);
+
+     // directivity over the wavelength in [wl_min, wl_max] (non-dispersive indices); N should
+     // suit the shortest wavelength
+std::vector<ScanPoint> scan_directivity_wl(const std::vector<double> &RL,
+                                           const std::vector< std::complex<double> > &eL,
+                                           const double &Rd,
+                                           const double &px, const double &py, const double &pz,
+                                           const double wl_min, const double wl_max,
+                                           std::vector<ScanPoint> *peaks = nullptr,
+                                           const ScanSettings &settings = ScanSettings(),
+                                           const double th = 0.,
+                                           const double ph = 0.,
+                                           const int N = 41);
+
+#endif
@@ -22,6 +22,7 @@ along with sphereml. If not, see <https://www.gnu.org/licenses/>.
 
 #include <complex>
 #include <algorithm>
+#include <limits>
 #include <math.h>
 #define _USE_MATH_DEFINES
 
@@ -258,6 +259,32 @@ Complex besh2d(Complex z, int n) {
 //     }
 }
 
+void besj_array(Complex z, int N, Complex *J, Complex *Jd) {
+          // ratios j_n/j_(n-1) by downward recursion (stored in Jd), anchored at j_0,
+          // or at j_1 near the zeros of j_0
+     int n, L = N + int(abs(z)) + 20;
+     Complex r = 0., j0 = besj0(z), j1 = besj1(z);
+     for (n=L; n>0; --n) {
+          r = z/(2.*n+1. - z*r);
+          if (n < N) Jd[n] = r;
+     }
+     J[0] = j0;
+     if (abs(j0) < 0.1*abs(j1)) {J[1] = j1; n = 2;}
+     else n = 1;
+     for (; n<N; ++n) J[n] = Jd[n]*J[n-1];
+     for (n=N-1; n>0; --n) Jd[n] = J[n-1] - double(n+1)/z*J[n];
+     Jd[0] = -J[1];
+}
+
+void besh1_array(Complex z, int N, Complex *H, Complex *Hd) {
+          // the upward recursion is stable for h1 (dominant solution)
+     int n;
+     H[0] = besh10(z); H[1] = besh11(z);
+     for (n=1; n<N-1; ++n) H[n+1] = (2.*n+1.)/z*H[n] - H[n-1];
+     Hd[0] = -H[1];
+     for (n=1; n<N; ++n) Hd[n] = H[n-1] - double(n+1)/z*H[n];
+}
+
      // Legendre polynomials
 
 double pLegn(double t, int nn) {
@@ -388,6 +415,52 @@ double LTaun(double t, int n, int m) {
      else {return -sin(t)*paLegnd(t,n,m);}
 }
 
+void legendre_pitau(double t, int N, int m, double *P, double *Pi, double *Tau) {
+          // the recursion runs over P_n^m/sin(t), which is regular at the poles;
+          // for m == 0 tau is obtained from P_n^1
+     int n, i, mm = (m > 0) ? m : 1;
+     double tc = cos(t), ts = sin(t), tv, t1, t2, q1, q2;
+     for (n=0; n<N; ++n) P[n] = Pi[n] = Tau[n] = 0.;
+     if (mm < N) {
+          tv = log(mm+0.5); for (i=2; i<2*mm+1; ++i) tv -= log(double(i));
+          tv *= 0.5; for (i=2; 2*i-1<2*mm; ++i) tv += log(double(2*i-1));
+          Pi[mm] = q2 = exp(tv)*pow(ts,mm-1); q1 = t2 = 0.;
+          for (i=mm; i<N-1; ++i) {
+               t1 = t2; t2 = sqrt((i+mm+1.)*(i-mm+1.)/(2*i+1.)/(2*i+3));
+               Pi[i+1] = (tc*q2 - t1*q1)/t2; q1 = q2; q2 = Pi[i+1];
+          }
+     }
+     if (m == 0) {
+          for (n=1; n<N; ++n) {Tau[n] = -sqrt(n*(n+1.))*ts*Pi[n]; Pi[n] = 0.;}
+          P[0] = q2 = pLegn0(t); q1 = t2 = 0.;
+          for (i=0; i<N-1; ++i) {
+               t1 = t2; t2 = (i+1.)/sqrt((2*i+1.)*(2*i+3.));
+               P[i+1] = (tc*q2 - t1*q1)/t2; q1 = q2; q2 = P[i+1];
+          }
+     }
+     else for (n=N-1; n>=m; --n) {
+          Tau[n] = n*tc*Pi[n] - sqrt((n*n-m*m)*(2*n+1.)/(2*n-1.))*Pi[n-1];
+          P[n] = ts*Pi[n]; Pi[n] *= m;
+     }
+}
+
+     // Gauss-Legendre quadrature
+
+void gauss_legendre(int n, double a, double b, double *x, double *w) {
+     int i, k; double z, z1, p1, p2, p3, pp, xm = 0.5*(b+a), xl = 0.5*(b-a);
+     for (i=0; i<(n+1)/2; ++i) {
+          z = cos(M_PI*(i+0.75)/(n+0.5));
+          do {
+               p1 = 1.; p2 = 0.;
+               for (k=0; k<n; ++k) {p3 = p2; p2 = p1; p1 = ((2*k+1.)*z*p2 - k*p3)/(k+1.);}
+               pp = n*(z*p1 - p2)/(z*z - 1.);
+               z1 = z; z = z1 - p1/pp;
+          } while (fabs(z-z1) > 1.e-14);
+          x[i] = xm - xl*z; x[n-1-i] = xm + xl*z;
+          w[i] = w[n-1-i] = 2.*xl/((1.-z*z)*pp*pp);
+     }
+}
+
      // spherical vector functions
 
 Vector svfRgM(Complex z, double th, double ph, int n, int m) {
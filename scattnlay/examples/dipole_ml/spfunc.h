@@ -72,6 +72,10 @@ Complex besh2(Complex, int);
 Complex besh1d(Complex, int);
 Complex besh2d(Complex, int);
 
+     // all orders n < N (N > 1) at once, with derivatives
+void besj_array(Complex z, int N, Complex *J, Complex *Jd);
+void besh1_array(Complex z, int N, Complex *H, Complex *Hd);
+
 inline Complex bes_dzj(Complex z, int n) {return besj(z,n)+z*besjd(z,n);};
 inline Complex bes_dzy(Complex z, int n) {return besy(z,n)+z*besyd(z,n);};
 inline Complex bes_dzh1(Complex z, int n) {return besh1(z,n)+z*besh1d(z,n);};
@@ -92,6 +96,11 @@ double paLegn(double t, int n, int m);
 double paLegnd(double t, int n, int m);
 double LPin(double t, int n, int m);
 double LTaun(double t, int n, int m);
+void legendre_pitau(double t, int N, int m, double *P, double *Pi, double *Tau); // all n<N at once
+
+     // Gauss-Legendre quadrature on [a,b] //
+
+void gauss_legendre(int n, double a, double b, double *x, double *w);
 
      // spherical functions //
 
@@ -73,6 +73,26 @@ Vector SphereML::calc_edz(double px, double py, double pz, Complex krz, int in)
      return VA;
 }
 
+     // calc_edz is linear in (px,py,pz): the three unit-dipole expansions share Bessel function values
+void SphereML::calc_edz_xyz(Complex krz, int in, Vector *VA) {
+     int n, k, nm, NN = N*N;
+     double tv = -0.25/sqrt(M_PI), tvn;
+     Complex zf, zfd, te, th;
+     for (k=0; k<3; ++k) VA[k] = Vector(2*NN); // zero initialized
+     for (n=1; n<N; ++n) {
+          tvn = tv*sqrt(2*n+1.); nm = n*(n+1);
+          if (in == 1) {zf = besh1(krz,n); zfd = besh1d(krz,n);} // field inside dipole radius
+          else {zf = besj(krz,n); zfd = besjd(krz,n);} // field outside dipole radius
+          te = tvn*zf; th = j_*tvn*(zfd + zf/krz);
+          VA[0].Data[nm-1] = te; VA[0].Data[nm+1] = te; // pp = pm = 1
+          VA[0].Data[NN+nm-1] = th; VA[0].Data[NN+nm+1] = -th;
+          VA[1].Data[nm-1] = -j_*te; VA[1].Data[nm+1] = j_*te; // pp = j, pm = -j
+          VA[1].Data[NN+nm-1] = -j_*th; VA[1].Data[NN+nm+1] = -j_*th;
+          VA[2].Data[NN+nm] = -2.*j_*tvn*sqrt(n*(n+1.))*zf/krz;
+          tv = -tv;
+     }
+}
+
 Vector SphereML::calc_far(const Vector &V, double th, double ph) {
      int m, n, NN = N*N; double tv;
      Complex tc, tc1, tc2, tc3, tc4, *te;
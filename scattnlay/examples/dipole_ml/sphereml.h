@@ -33,6 +33,7 @@ public:
 
      Vector calc_pw(double as, double ap, double th, double ph);
      Vector calc_edz(double px, double py, double pz, Complex krz, int in);
+     void calc_edz_xyz(Complex krz, int in, Vector *VA); // VA[0..2] for unit x, y, z dipoles
 
      Vector calc_far(const Vector &V, double th, double ph);
      double calc_Psca(const Vector &VS, double tC);
@@ -0,0 +1,277 @@
+///
+/// @file   surrogate.cpp
+/// @brief  Incremental Gaussian-process model of the fitness.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./surrogate.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+namespace jade {
+  namespace {
+    /// @brief Noise variance of the standardized fitness, also the
+    /// smallest pivot of the Cholesky factor.
+    const double kNugget = 1e-8;
+    /// @brief Candidate length scales of a rebuild.
+    const int kLengthScales = 5;
+  }  // end of namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::Init(long dimension, long capacity,                  // NOLINT
+                       const std::vector<double> &lbound,
+                       const std::vector<double> &ubound) {
+    if (dimension < 1 || capacity < 4)
+      throw std::invalid_argument("Surrogate needs dimension >= 1 and "
+                                  "capacity >= 4!");
+    if (static_cast<long>(lbound.size()) != dimension                  // NOLINT
+        || static_cast<long>(ubound.size()) != dimension)              // NOLINT
+      throw std::invalid_argument("Bounds should be set for all coordinates!");
+    dimension_ = dimension;
+    capacity_ = capacity;
+    lbound_ = lbound;
+    ubound_ = ubound;
+    size_ = 0;
+    length_scale_ = 0;
+    mean_ = 0;
+    scale_ = 1;
+    variance_ = 1;
+    points_.assign(capacity*dimension, 0.);
+    values_.assign(capacity, 0.);
+    factor_.assign(capacity*capacity, 0.);
+    weights_.assign(capacity, 0.);
+  }  // end of void Surrogate::Init()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double Surrogate::Kernel(const double *a, const double *b) const {
+    double r2 = 0;
+    for (long c = 0; c < dimension_; ++c) r2 += (a[c] - b[c])*(a[c] - b[c]);  // NOLINT
+    return std::exp(-0.5*r2/(length_scale_*length_scale_));
+  }  // end of double Surrogate::Kernel(const double *a, const double *b)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool Surrogate::Append(const double *u, double y) {
+    const long n = size_;                                              // NOLINT
+    // New row l of the factor: L l = k, pivot^2 = k(u, u) + nugget - l.l
+    double *row = &factor_[n*capacity_];
+    double pivot2 = 1. + kNugget;
+    for (long j = 0; j < n; ++j) {                                     // NOLINT
+      double sum = Kernel(u, &points_[j*dimension_]);
+      const double *lj = &factor_[j*capacity_];
+      for (long k = 0; k < j; ++k) sum -= lj[k]*row[k];                // NOLINT
+      row[j] = sum/lj[j];
+      pivot2 -= row[j]*row[j];
+    }
+    if (pivot2 < kNugget) return false;
+    row[n] = std::sqrt(pivot2);
+    std::copy(u, u + dimension_, &points_[n*dimension_]);
+    values_[n] = y;
+    ++size_;
+    return true;
+  }  // end of bool Surrogate::Append(const double *u, double y)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::Rebuild() {
+    const long n = size_;                                              // NOLINT
+    double sum = 0, sum2 = 0;
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      sum += values_[i];
+      sum2 += values_[i]*values_[i];
+    }
+    mean_ = n > 0 ? sum/n : 0.;
+    const double variance = n > 1 ? (sum2 - n*mean_*mean_)/(n - 1) : 0.;
+    scale_ = variance > 0 ? std::sqrt(variance) : 1.;
+    std::vector<double> distances;
+    for (long i = 0; i < n; ++i)                                       // NOLINT
+      for (long j = 0; j < i; ++j) {                                   // NOLINT
+        double r2 = 0;
+        for (long c = 0; c < dimension_; ++c) {                        // NOLINT
+          const double d = points_[i*dimension_ + c] - points_[j*dimension_ + c];
+          r2 += d*d;
+        }
+        if (r2 > 0) distances.push_back(std::sqrt(r2));
+      }
+    double median = 1.;
+    if (!distances.empty()) {
+      std::nth_element(distances.begin(),
+                       distances.begin() + distances.size()/2, distances.end());
+      median = distances[distances.size()/2];
+    }
+    // The length scale is the one of median/2^k with the least
+    // leave-one-out error, e_i = weights_i/(K^-1)_ii. Each candidate is
+    // factored in the original order, dependent points are dropped.
+    const std::vector<double> points(points_.begin(),
+                                     points_.begin() + n*dimension_);
+    const std::vector<double> values(values_.begin(), values_.begin() + n);
+    double best_error = std::numeric_limits<double>::infinity();
+    double best_scale = median;
+    std::vector<double> column;
+    for (int k = 0; k < kLengthScales; ++k) {
+      length_scale_ = median*std::pow(0.5, k);
+      size_ = 0;
+      for (long i = 0; i < n; ++i) Append(&points[i*dimension_], values[i]);  // NOLINT
+      UpdateWeights();
+      const long m = size_;                                            // NOLINT
+      double error = 0;
+      for (long i = 0; i < m; ++i) {                                   // NOLINT
+        // Column i of L^-1, (K^-1)_ii is its squared norm.
+        column.assign(m, 0.);
+        column[i] = 1./factor_[i*capacity_ + i];
+        double inverse = column[i]*column[i];
+        for (long r = i + 1; r < m; ++r) {                             // NOLINT
+          const double *lr = &factor_[r*capacity_];
+          double c = 0;
+          for (long q = i; q < r; ++q) c -= lr[q]*column[q];           // NOLINT
+          column[r] = c/lr[r];
+          inverse += column[r]*column[r];
+        }
+        const double e = weights_[i]/inverse;
+        error += e*e;
+      }
+      // Dropped points count as errors of the full variance.
+      error = (error + (n - m))/n;
+      if (error < best_error) {
+        best_error = error;
+        best_scale = length_scale_;
+      }
+    }  // end of for each length scale
+    length_scale_ = best_scale;
+    size_ = 0;
+    for (long i = 0; i < n; ++i) Append(&points[i*dimension_], values[i]);  // NOLINT
+  }  // end of void Surrogate::Rebuild()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::UpdateWeights() {
+    // weights = K^-1 (y - mean)/scale by two triangular solves.
+    const long n = size_;                                              // NOLINT
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      const double *li = &factor_[i*capacity_];
+      double sum = (values_[i] - mean_)/scale_;
+      for (long k = 0; k < i; ++k) sum -= li[k]*weights_[k];           // NOLINT
+      weights_[i] = sum/li[i];
+    }
+    for (long i = n - 1; i >= 0; --i) {                                // NOLINT
+      double sum = weights_[i];
+      for (long k = i + 1; k < n; ++k) sum -= factor_[k*capacity_ + i]*weights_[k];  // NOLINT
+      weights_[i] = sum/factor_[i*capacity_ + i];
+    }
+    // Kriging estimate of the process variance, (y - mean)^T K^-1
+    // (y - mean)/size in standardized units.
+    double quadratic = 0;
+    for (long i = 0; i < n; ++i)                                       // NOLINT
+      quadratic += (values_[i] - mean_)/scale_*weights_[i];
+    variance_ = n > 0 && quadratic > 0 ? quadratic/n : 1.;
+  }  // end of void Surrogate::UpdateWeights()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::Add(const std::vector<double> &x,
+                      const std::vector<double> &y) {
+    std::vector<double> u(dimension_);
+    bool is_rebuilt = false;
+    for (unsigned long i = 0; i < y.size(); ++i) {                     // NOLINT
+      if (!std::isfinite(y[i])) continue;
+      for (long c = 0; c < dimension_; ++c)                            // NOLINT
+        u[c] = (x[i*dimension_ + c] - lbound_[c])/(ubound_[c] - lbound_[c]);
+      if (size_ == capacity_) {
+        // Keep the newest half.
+        const long kept = capacity_/2;                                 // NOLINT
+        std::copy(points_.begin() + (size_ - kept)*dimension_,
+                  points_.begin() + size_*dimension_, points_.begin());
+        std::copy(values_.begin() + (size_ - kept), values_.begin() + size_,
+                  values_.begin());
+        size_ = kept;
+        is_rebuilt = true;
+      }
+      if (length_scale_ > 0 && !is_rebuilt) {
+        Append(&u.front(), y[i]);
+      } else {
+        std::copy(u.begin(), u.end(), &points_[size_*dimension_]);
+        values_[size_++] = y[i];
+        is_rebuilt = true;
+      }
+    }  // end of for each new point
+    // A new model (or one over capacity) is fitted to all points.
+    if (is_rebuilt) Rebuild();
+    UpdateWeights();
+  }  // end of void Surrogate::Add()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::Predict(const double *x, double *mean,
+                          double *stddev) const {
+    const long n = size_;                                              // NOLINT
+    std::vector<double> u(dimension_), v(n);
+    for (long c = 0; c < dimension_; ++c)                              // NOLINT
+      u[c] = (x[c] - lbound_[c])/(ubound_[c] - lbound_[c]);
+    double mu = 0, variance = 1. + kNugget;
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      const double k = Kernel(&u.front(), &points_[i*dimension_]);
+      mu += k*weights_[i];
+      // Forward substitution for L^-1 k.
+      const double *li = &factor_[i*capacity_];
+      double sum = k;
+      for (long j = 0; j < i; ++j) sum -= li[j]*v[j];                  // NOLINT
+      v[i] = sum/li[i];
+      variance -= v[i]*v[i];
+    }
+    *mean = mean_ + scale_*mu;
+    *stddev = scale_*std::sqrt(variance_*std::max(variance, 0.));
+  }  // end of void Surrogate::Predict()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<double> Surrogate::GetState() const {
+    std::vector<double> state = {static_cast<double>(size_),
+                                 length_scale_, mean_, scale_};
+    state.insert(state.end(), points_.begin(),
+                 points_.begin() + size_*dimension_);
+    state.insert(state.end(), values_.begin(), values_.begin() + size_);
+    for (long i = 0; i < size_; ++i)                                   // NOLINT
+      state.insert(state.end(), &factor_[i*capacity_],
+                   &factor_[i*capacity_] + i + 1);
+    return state;
+  }  // end of std::vector<double> Surrogate::GetState()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void Surrogate::SetState(const std::vector<double> &state) {
+    const long n = state.empty() ? -1 : static_cast<long>(state[0]);  // NOLINT
+    if (n < 0 || n > capacity_ || static_cast<long>(state.size())     // NOLINT
+        != 4 + n*dimension_ + n + n*(n + 1)/2)
+      throw std::runtime_error("Bad surrogate state!");
+    size_ = n;
+    length_scale_ = state[1];
+    mean_ = state[2];
+    scale_ = state[3];
+    const double *s = &state[4];
+    std::copy(s, s + n*dimension_, points_.begin());
+    s += n*dimension_;
+    std::copy(s, s + n, values_.begin());
+    s += n;
+    for (long i = 0; i < n; ++i) {                                     // NOLINT
+      std::copy(s, s + i + 1, &factor_[i*capacity_]);
+      s += i + 1;
+    }
+    UpdateWeights();
+  }  // end of void Surrogate::SetState()
+}  // end of namespace jade
@@ -0,0 +1,70 @@
+#ifndef SRC_SURROGATE_H_
+#define SRC_SURROGATE_H_
+///
+/// @file   surrogate.h
+/// @brief  Gaussian-process model of the fitness on the recently
+/// evaluated points, used by SubPopulation to pre-select trials.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <vector>
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Gaussian process with the squared exponential kernel in
+  /// coordinates scaled to [0, 1] by the bounds, constant mean and the
+  /// kriging estimate of the process variance. The Cholesky factor of
+  /// the kernel matrix is extended by one row per new point, O(size^2);
+  /// a point that would make it singular (a near duplicate) is
+  /// dropped. When `capacity` points are reached, the model is rebuilt
+  /// from the newest half of them with the standardization and the
+  /// length scale (least leave-one-out error) fitted anew, so it
+  /// follows the population as it contracts.
+  class Surrogate {
+   public:
+    void Init(long dimension, long capacity,                           // NOLINT
+              const std::vector<double> &lbound,
+              const std::vector<double> &ubound);
+    /// @brief Add the rows of x with fitness y, non-finite values are
+    /// skipped.
+    void Add(const std::vector<double> &x, const std::vector<double> &y);
+    /// @brief Predicted fitness and its standard deviation at x, thread
+    /// safe.
+    void Predict(const double *x, double *mean, double *stddev) const;
+    long Size() const {return size_;}                                  // NOLINT
+    /// @brief Whole model as a flat vector, e.g. for checkpoints.
+    std::vector<double> GetState() const;
+    void SetState(const std::vector<double> &state);
+
+   private:
+    /// @brief Extend the factor by the scaled point u, false if it is
+    /// dependent on the kept points.
+    bool Append(const double *u, double y);
+    void Rebuild();
+    /// @brief Weights of the kernel vector in the mean prediction.
+    void UpdateWeights();
+    double Kernel(const double *a, const double *b) const;
+    long dimension_ = 0, capacity_ = 0, size_ = 0;                     // NOLINT
+    std::vector<double> lbound_, ubound_;
+    double length_scale_ = 0, mean_ = 0, scale_ = 1;
+    /// @brief Process variance relative to scale_^2.
+    double variance_ = 1;
+    /// @brief Scaled points and fitness, size_ rows; lower triangular
+    /// Cholesky factor, capacity_ x capacity_; weights.
+    std::vector<double> points_, values_, factor_, weights_;
+  };  // end of class Surrogate
+}  // end of namespace jade
+#endif  // SRC_SURROGATE_H_
@@ -0,0 +1,372 @@
+///
+/// @file   testfunctions.cpp
+/// @brief  Benchmark functions f1-f13 of functions.py.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include "./testfunctions.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+namespace jade {
+  namespace {
+    /// @brief Individuals evaluated together by the SIMD kernels.
+    const int kLanes = 8;
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // Kernels evaluate L individuals stored coordinate by coordinate,
+    // x[i*L + l] is coordinate i of individual l, so the inner loops
+    // over l vectorize for any dimension (loops with libm calls are
+    // left to the compiler). With L = 1 x is a plain vector, which
+    // gives the scalar functions.
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    inline double Sqr(double x) {return x*x;}
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief u() of functions.py, k*(|x| - a)^4 outside [-a, a].
+    inline double U(double xi, double a, double k) {
+      const double t = xi > a ? xi - a : (xi < -a ? -xi - a : 0.);
+      return k*Sqr(Sqr(t));
+    }  // end of double U()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F1(const double *x, long dimension, double *f) {              // NOLINT
+      double sum[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l) sum[l] += xi[l]*xi[l];
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F1()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F2(const double *x, long dimension, double *f) {              // NOLINT
+      double sum[L] = {}, product[L];
+      std::fill(product, product + L, 1.);
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l) {
+          sum[l] += std::abs(xi[l]);
+          product[l] *= std::abs(xi[l]);
+        }
+      }
+#pragma omp simd
+      for (int l = 0; l < L; ++l) f[l] = sum[l] + product[l];
+    }  // end of void F2()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F3(const double *x, long dimension, double *f) {              // NOLINT
+      // As in functions.py, the partial sums are of x[:i].
+      double sum[L] = {}, partial[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l) {
+          sum[l] += partial[l]*partial[l];
+          partial[l] += xi[l];
+        }
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F3()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F4(const double *x, long dimension, double *f) {              // NOLINT
+      double max[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l) max[l] = std::max(max[l], std::abs(xi[l]));
+      }
+      std::copy(max, max + L, f);
+    }  // end of void F4()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F5(const double *x, long dimension, double *f) {              // NOLINT
+      double sum[L] = {};
+      for (long i = 0; i < dimension - 1; ++i) {                       // NOLINT
+        const double *xi = x + i*L, *xn = xi + L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l)
+          sum[l] += 100*Sqr(xn[l] - xi[l]*xi[l]) + Sqr(xi[l] - 1);
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F5()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F6(const double *x, long dimension, double *f) {              // NOLINT
+      double sum[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+#pragma omp simd
+        for (int l = 0; l < L; ++l) sum[l] += Sqr(xi[l] + 0.5);
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F6()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F7(const double *x, long dimension, double *f) {              // NOLINT
+      thread_local std::mt19937_64 generator;
+      std::uniform_real_distribution<double> noise(0, 1);
+      double sum[L] = {}, uniform[L];
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l) uniform[l] = noise(generator);
+#pragma omp simd
+        for (int l = 0; l < L; ++l)
+          sum[l] += Sqr(Sqr(xi[l]))*i + uniform[l];
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F7()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F8(const double *x, long dimension, double *f) {              // NOLINT
+      // As in functions.py, sin(|x|) instead of sin(sqrt(|x|)), the
+      // minimum is at x = 497.944... on each axis.
+      double sum[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l) sum[l] -= xi[l]*std::sin(std::abs(xi[l]));
+      }
+#pragma omp simd
+      for (int l = 0; l < L; ++l) f[l] = sum[l] + dimension*418.98288727243369;
+    }  // end of void F8()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F9(const double *x, long dimension, double *f) {              // NOLINT
+      double sum[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l)
+          sum[l] += xi[l]*xi[l] - 10*std::cos(2*M_PI*xi[l]) + 10;
+      }
+      std::copy(sum, sum + L, f);
+    }  // end of void F9()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F10(const double *x, long dimension, double *f) {             // NOLINT
+      // As in functions.py, the first exponent has mean(x^2) without sqrt.
+      double sum2[L] = {}, sum_cos[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l) {
+          sum2[l] += xi[l]*xi[l];
+          sum_cos[l] += std::cos(2*M_PI*xi[l]);
+        }
+      }
+      for (int l = 0; l < L; ++l)
+        f[l] = -20*std::exp(-0.2*sum2[l]/dimension)
+          - std::exp(sum_cos[l]/dimension) + 20 + M_E;
+    }  // end of void F10()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F11(const double *x, long dimension, double *f) {             // NOLINT
+      // As in functions.py, the product term starts from 0, so only the
+      // sum of squares remains.
+      double sum[L] = {}, product[L] = {};
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        const double scale = 1./std::sqrt(i + 1.);
+        for (int l = 0; l < L; ++l) {
+          sum[l] += xi[l]*xi[l];
+          product[l] *= std::cos(xi[l]*scale);
+        }
+      }
+#pragma omp simd
+      for (int l = 0; l < L; ++l) f[l] = sum[l]/4000 - product[l] + 1;
+    }  // end of void F11()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F12(const double *x, long dimension, double *f) {             // NOLINT
+      auto y = [](double xi) {return 1. + (xi + 1.)/4.;};
+      double sum_y[L] = {}, sum_u[L] = {};
+      for (long i = 0; i < dimension - 1; ++i) {                       // NOLINT
+        const double *xi = x + i*L, *xn = xi + L;
+        for (int l = 0; l < L; ++l)
+          sum_y[l] += Sqr(y(xi[l]) - 1.)
+            *(1. + 10.*Sqr(std::sin(M_PI*y(xn[l]))));
+      }
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l) sum_u[l] += U(xi[l], 10., 100.);
+      }
+      const double *first = x, *last = x + (dimension - 1)*L;
+      for (int l = 0; l < L; ++l)
+        f[l] = M_PI/dimension*(10.*Sqr(std::sin(M_PI*y(first[l]))) + sum_y[l]
+                               + Sqr(y(last[l]) - 1.)) + sum_u[l];
+    }  // end of void F12()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    template <int L>
+    void F13(const double *x, long dimension, double *f) {             // NOLINT
+      double sum_y[L] = {}, sum_u[L] = {};
+      for (long i = 0; i < dimension - 1; ++i) {                       // NOLINT
+        const double *xi = x + i*L, *xn = xi + L;
+        for (int l = 0; l < L; ++l)
+          sum_y[l] += Sqr(xi[l] - 1.)*(1. + Sqr(std::sin(3.*M_PI*xn[l])));
+      }
+      for (long i = 0; i < dimension; ++i) {                           // NOLINT
+        const double *xi = x + i*L;
+        for (int l = 0; l < L; ++l) sum_u[l] += U(xi[l], 5., 100.);
+      }
+      const double *first = x, *last = x + (dimension - 1)*L;
+      for (int l = 0; l < L; ++l)
+        f[l] = 0.1*(Sqr(std::sin(3.*M_PI*first[l])) + sum_y[l]
+                    + Sqr(last[l] - 1.)
+                    *(1. + Sqr(std::sin(2.*M_PI*last[l])))) + sum_u[l];
+    }  // end of void F13()
+    // ********************************************************************** //
+    // ********************************************************************** //
+    // ********************************************************************** //
+    /// @brief Batch of `size` individuals stored row by row: blocks of
+    /// kLanes rows are transposed and evaluated by the kernel, the last
+    /// block is padded with zeros.
+    template <void (*Kernel)(const double *, long, double *)>          // NOLINT
+    void Batch(const double *x, long size, long dimension,            // NOLINT
+               double *fitness) {
+      std::vector<double> block(dimension*kLanes);
+      double f[kLanes];
+      for (long first = 0; first < size; first += kLanes) {            // NOLINT
+        const long lanes = std::min<long>(kLanes, size - first);       // NOLINT
+        if (lanes < kLanes) std::fill(block.begin(), block.end(), 0.);
+        for (long l = 0; l < lanes; ++l) {                             // NOLINT
+          const double *row = x + (first + l)*dimension;
+          for (long i = 0; i < dimension; ++i) block[i*kLanes + l] = row[i];  // NOLINT
+        }
+        Kernel(&block.front(), dimension, f);
+        std::copy(f, f + lanes, fitness + first);
+      }
+    }  // end of void Batch()
+  }  // end of namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double f1(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F1<1>(x, dimension, &f);
+    return f;
+  }  // end of double f1()
+  double f2(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F2<1>(x, dimension, &f);
+    return f;
+  }  // end of double f2()
+  double f3(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F3<1>(x, dimension, &f);
+    return f;
+  }  // end of double f3()
+  double f4(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F4<1>(x, dimension, &f);
+    return f;
+  }  // end of double f4()
+  double f5(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F5<1>(x, dimension, &f);
+    return f;
+  }  // end of double f5()
+  double f6(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F6<1>(x, dimension, &f);
+    return f;
+  }  // end of double f6()
+  double f7(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F7<1>(x, dimension, &f);
+    return f;
+  }  // end of double f7()
+  double f8(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F8<1>(x, dimension, &f);
+    return f;
+  }  // end of double f8()
+  double f9(const double *x, long dimension) {                         // NOLINT
+    double f;
+    F9<1>(x, dimension, &f);
+    return f;
+  }  // end of double f9()
+  double f10(const double *x, long dimension) {                        // NOLINT
+    double f;
+    F10<1>(x, dimension, &f);
+    return f;
+  }  // end of double f10()
+  double f11(const double *x, long dimension) {                        // NOLINT
+    double f;
+    F11<1>(x, dimension, &f);
+    return f;
+  }  // end of double f11()
+  double f12(const double *x, long dimension) {                        // NOLINT
+    double f;
+    F12<1>(x, dimension, &f);
+    return f;
+  }  // end of double f12()
+  double f13(const double *x, long dimension) {                        // NOLINT
+    double f;
+    F13<1>(x, dimension, &f);
+    return f;
+  }  // end of double f13()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  const std::vector<TestFunction> &TestFunctions() {
+    static const std::vector<TestFunction> functions = {
+      {"f1", f1, Batch<F1<kLanes> >, -100, 100, 0, 0},
+      {"f2", f2, Batch<F2<kLanes> >, -10, 10, 0, 0},
+      {"f3", f3, Batch<F3<kLanes> >, -100, 100, 0, 0},
+      {"f4", f4, Batch<F4<kLanes> >, -100, 100, 0, 0},
+      {"f5", f5, Batch<F5<kLanes> >, -30, 30, 0, 0},
+      {"f6", f6, Batch<F6<kLanes> >, -100, 100, 0, 0},
+      {"f7", f7, Batch<F7<kLanes> >, -1.28, 1.28, 0, 0},
+      {"f8", f8, Batch<F8<kLanes> >, -500, 500, 0, -78.96055244996938},
+      {"f9", f9, Batch<F9<kLanes> >, -5.12, 5.12, 0, 0},
+      {"f10", f10, Batch<F10<kLanes> >, -32, 32, 0, 0},
+      {"f11", f11, Batch<F11<kLanes> >, -600, 600, 1, 0},
+      {"f12", f12, Batch<F12<kLanes> >, -50, 50, 0, 0},
+      {"f13", f13, Batch<F13<kLanes> >, -50, 50, 0, 0}};
+    return functions;
+  }  // end of const std::vector<TestFunction> &TestFunctions()
+}  // end of namespace jade
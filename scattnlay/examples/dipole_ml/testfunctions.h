@@ -0,0 +1,60 @@
+#ifndef SRC_TESTFUNCTIONS_H_
+#define SRC_TESTFUNCTIONS_H_
+///
+/// @file   testfunctions.h
+/// @brief  Benchmark functions f1-f13 of functions.py (Xin Yao, Yong
+/// Liu and Guangming Lin, 'Evolutionary programming made faster',
+/// IEEE TEC 3(2), 1999) for JADE++ with the same definitions and
+/// bounds, so results compare with the Python notebooks.
+///
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+#include <vector>
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Minimization problem on the box [lbound, ubound]^dimension.
+  struct TestFunction {
+    const char *name;
+    double (*function)(const double *x, long dimension);              // NOLINT
+    /// @brief The same function of `size` vectors stored row by row in
+    /// x, vectorized over the individuals (BatchFitnessFunction).
+    void (*batch)(const double *x, long size, long dimension,         // NOLINT
+                  double *fitness);
+    double lbound, ubound;
+    /// @brief Global minimum value of the functions.py definition is
+    /// minimum + dimension*minimum_per_dimension.
+    double minimum, minimum_per_dimension;
+  };
+  double f1(const double *x, long dimension);                          // NOLINT
+  double f2(const double *x, long dimension);                          // NOLINT
+  double f3(const double *x, long dimension);                          // NOLINT
+  double f4(const double *x, long dimension);                          // NOLINT
+  double f5(const double *x, long dimension);                          // NOLINT
+  double f6(const double *x, long dimension);                          // NOLINT
+  /// @brief Noisy quartic, thread safe.
+  double f7(const double *x, long dimension);                          // NOLINT
+  double f8(const double *x, long dimension);                          // NOLINT
+  double f9(const double *x, long dimension);                          // NOLINT
+  double f10(const double *x, long dimension);                         // NOLINT
+  double f11(const double *x, long dimension);                         // NOLINT
+  double f12(const double *x, long dimension);                         // NOLINT
+  double f13(const double *x, long dimension);                         // NOLINT
+  /// @brief f1..f13 with bounds of functions.py, each with a scalar
+  /// and a batch version.
+  const std::vector<TestFunction> &TestFunctions();
+}  // end of namespace jade
+#endif  // SRC_TESTFUNCTIONS_H_